@@ -2,8 +2,11 @@
 
 #include <rpc/client.h>
 #include <rpc/msgpack.hpp>  // clmdep_msgpack::object_handle
+#include <rpc/rpc_error.h>
 
+#include <algorithm>
 #include <atomic>
+#include <chrono>
 #include <condition_variable>
 #include <cstdint>
 #include <cstdlib>
@@ -11,6 +14,7 @@
 #include <iostream>
 #include <memory>
 #include <mutex>
+#include <numeric>
 #include <queue>
 #include <string>
 #include <thread>
@@ -18,13 +22,21 @@
 #include <utility>
 #include <vector>
 
+// RPCGameClient
+//    With several server addresses (a replica group), the client talks to
+//    one contact replica at a time. If the contact's connection fails, the
+//    client moves to the next address and resends unanswered requests
+//    there; replicas recognize resent requests by serial number.
+
 class RPCGameClient {
 public:
-    static constexpr int WINDOW = 128;
+    static constexpr int WINDOW = client_window;
     static constexpr int WORKERS = 2; // can be 1; callback is serialized anyway
+    static constexpr auto FAILOVER_POLL = std::chrono::milliseconds(100);
 
-    RPCGameClient(std::string host, uint16_t port)
-        : _cli(std::move(host), port) {
+    RPCGameClient(std::vector<std::pair<std::string, uint16_t>> contacts)
+        : _contacts(std::move(contacts)) {
+        _cli = std::make_shared<rpc::client>(_contacts[0].first, _contacts[0].second);
         _workers.reserve(WORKERS);
         for (int i = 0; i < WORKERS; ++i) {
             _workers.emplace_back([this] { worker_loop(); });
@@ -48,19 +60,19 @@ public:
             _cv.wait(lk, [&] { return _in_flight < WINDOW; });
             ++_in_flight;
         }
-    };
-
-        const uint64_t serial = _serial.fetch_add(1, std::memory_order_relaxed);
-
-        // rpclib requires owning string for the message
-        std::string name_str(name, name_len);
 
-        std::future<clmdep_msgpack::object_handle> fut =
-            _cli.async_call("Try", serial, std::move(name_str), count);
+        // rpclib requires owning string for the message; we keep it in case
+        // the request must be resent
+        request r;
+        r.serial = _serial.fetch_add(1, std::memory_order_relaxed);
+        r.name.assign(name, name_len);
+        r.count = count;
+        r.sent = std::chrono::steady_clock::now();
+        issue(r);
 
         {
             std::lock_guard<std::mutex> lk(_qmu);
-            _pending.emplace(std::move(fut));
+            _pending.push(std::move(r));
         }
         _qcv.notify_one();
     }
@@ -71,7 +83,7 @@ public:
             _cv.wait(lk, [&] { return _in_flight == 0; });
         }
 
-        auto oh = _cli.call("Done");
+        auto oh = contact()->call("Done");
         auto tup = oh.as<std::tuple<std::string, std::string>>();
 
         const std::string& resp_client = std::get<0>(tup);
@@ -89,9 +101,79 @@ public:
                   << "\nserver checksums: "
                   << my_server_checksum << "/" << resp_server
                   << "\nmatch: " << (match ? "true\n" : "false\n");
+
+        // Per-RPC latency, send to response, for comparing server modes
+        if (!_latencies.empty()) {
+            std::sort(_latencies.begin(), _latencies.end());
+            double sum = std::accumulate(_latencies.begin(), _latencies.end(), 0.0);
+            size_t n = _latencies.size();
+            std::cout << std::format("latency: mean {:.0f}us p50 {:.0f}us p99 {:.0f}us\n",
+                                     sum / n, _latencies[n / 2], _latencies[n * 99 / 100]);
+        }
     }
 
 private:
+    struct request {
+        uint64_t serial;
+        std::string name;
+        uint64_t count;
+        std::chrono::steady_clock::time_point sent;
+        std::shared_ptr<rpc::client> cli;   // connection `response` uses
+        std::future<clmdep_msgpack::object_handle> response;
+    };
+
+    std::shared_ptr<rpc::client> contact() {
+        std::lock_guard<std::mutex> lk(_cli_mu);
+        return _cli;
+    }
+
+    // Send `r` to the current contact.
+    void issue(request& r) {
+        r.cli = contact();
+        r.response = r.cli->async_call("Try", r.serial, r.name, r.count);
+    }
+
+    // Wait for the response to `r`, resending it after a failover if its
+    // connection fails. Errors reported by the server are fatal.
+    uint64_t await(request& r) {
+        while (true) {
+            try {
+                if (r.response.wait_for(FAILOVER_POLL) == std::future_status::ready) {
+                    clmdep_msgpack::object_handle oh = r.response.get();
+                    return oh.get().as<uint64_t>();
+                }
+                auto state = r.cli->get_connection_state();
+                if (state == rpc::client::connection_state::initial
+                    || state == rpc::client::connection_state::connected) {
+                    continue;
+                }
+            } catch (const rpc::rpc_error&) {
+                throw;
+            } catch (const std::exception& e) {
+                std::cerr << "Try RPC failed: " << e.what() << "\n";
+            }
+            fail_over(r.cli);
+            issue(r);
+        }
+    }
+
+    // Move to the next contact, unless another worker already moved away
+    // from `failed`.
+    void fail_over(const std::shared_ptr<rpc::client>& failed) {
+        std::lock_guard<std::mutex> lk(_cli_mu);
+        if (_cli != failed) {
+            return;
+        }
+        if (++_failovers > _contacts.size()) {
+            std::cerr << "No server reachable\n";
+            std::exit(1);
+        }
+        _contact = (_contact + 1) % _contacts.size();
+        auto& [host, port] = _contacts[_contact];
+        std::cerr << std::format("failing over to {}:{}\n", host, port);
+        _cli = std::make_shared<rpc::client>(host, port);
+    }
+
     void release_slot() {
         std::lock_guard<std::mutex> lk(_mu);
         if (_in_flight > 0) --_in_flight;
@@ -100,24 +182,30 @@ private:
 
     void worker_loop() {
         while (true) {
-            std::future<clmdep_msgpack::object_handle> fut;
+            request r;
 
             {
                 std::unique_lock<std::mutex> lk(_qmu);
                 _qcv.wait(lk, [&] { return _stop || !_pending.empty(); });
                 if (_stop && _pending.empty()) return;
-                fut = std::move(_pending.front());
+                r = std::move(_pending.front());
                 _pending.pop();
             }
 
             try {
-                clmdep_msgpack::object_handle oh = fut.get();
-                uint64_t value = oh.get().as<uint64_t>();
+                uint64_t value = await(r);
+                {
+                    std::lock_guard<std::mutex> lk(_cli_mu);
+                    _failovers = 0;
+                }
 
                 // CRITICAL: serialize callback to match gRPC single-CQ-thread behavior
                 {
                     std::lock_guard<std::mutex> lk(_recv_mu);
                     client_recv_try_response(value);
+                    std::chrono::duration<double, std::micro> latency =
+                        std::chrono::steady_clock::now() - r.sent;
+                    _latencies.push_back(latency.count());
                 }
             } catch (const std::exception& e) {
                 release_slot();
@@ -130,7 +218,11 @@ private:
     }
 
 private:
-    rpc::client _cli;
+    std::vector<std::pair<std::string, uint16_t>> _contacts;
+    std::mutex _cli_mu;
+    std::shared_ptr<rpc::client> _cli;  // protected by `_cli_mu`
+    size_t _contact = 0;                // protected by `_cli_mu`
+    size_t _failovers = 0;              // since a response; by `_cli_mu`
     std::atomic<uint64_t> _serial{1};
 
     std::mutex _mu;
@@ -139,13 +231,14 @@ private:
 
     std::mutex _qmu;
     std::condition_variable _qcv;
-    std::queue<std::future<clmdep_msgpack::object_handle>> _pending;
+    std::queue<request> _pending;
     bool _stop = false;
 
     std::vector<std::thread> _workers;
 
     // Serialize client_recv_try_response() to prevent heap corruption
     std::mutex _recv_mu;
+    std::vector<double> _latencies;     // µs; protected by `_recv_mu`
 };
 
 static std::unique_ptr<RPCGameClient> client;
@@ -160,17 +253,25 @@ static inline void parse_address(const std::string& address, std::string& host_o
     port_out = static_cast<uint16_t>(std::stoi(address.substr(pos + 1)));
 }
 
+// `address` may list several comma-separated replica addresses; the client
+// starts with the first and fails over to the others in order.
+
 void client_connect(std::string address) {
-    std::string host;
-    uint16_t port = 0;
-    parse_address(address, host, port);
-    client = std::make_unique<RPCGameClient>(std::move(host), port);
+    std::vector<std::pair<std::string, uint16_t>> contacts;
+    size_t pos = 0;
+    while (pos <= address.size()) {
+        size_t comma = std::min(address.find(',', pos), address.size());
+        auto& [host, port] = contacts.emplace_back();
+        parse_address(address.substr(pos, comma - pos), host, port);
+        pos = comma + 1;
+    }
+    client = std::make_unique<RPCGameClient>(std::move(contacts));
 }
 
 void client_send_try(const char* name, size_t name_len, uint64_t count) {
-    client->send_try_windowed(name, name_len, count);
+    client->send_try(name, name_len, count);
 }
 
 void client_finish() {
-    client->finish_windowed();
+    client->finish();
 }
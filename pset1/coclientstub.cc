@@ -0,0 +1,444 @@
+#include "rpcgame.hh"
+
+#include <rpc/msgpack.hpp>  // clmdep_msgpack::packer, unpacker
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <coroutine>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <exception>
+#include <iostream>
+#include <memory>
+#include <numeric>
+#include <string>
+#include <tuple>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+// coclientstub.cc
+//    A single-threaded client stub built on coroutines. Each in-flight Try
+//    RPC is a lightweight task, the request window is an awaitable
+//    semaphore, and one epoll loop reads responses and flushes requests.
+//    The stub speaks msgpack-RPC directly, so it talks to the rpclib
+//    server in `serverstub.cc` (or `replicastub.cc`) unchanged.
+//
+//    `rpc_client::run` is not a coroutine, so `client_send_try` starts a
+//    task and then drives the event loop until no task is waiting for the
+//    window. Requests written while the window has room accumulate in the
+//    output buffer and are flushed together by the next loop iteration.
+
+namespace {
+
+// task
+//    A detached coroutine: starts immediately, frees itself on completion.
+
+struct task {
+    struct promise_type {
+        task get_return_object() noexcept { return {}; }
+        std::suspend_never initial_suspend() noexcept { return {}; }
+        std::suspend_never final_suspend() noexcept { return {}; }
+        void return_void() noexcept {}
+        void unhandled_exception() noexcept { std::terminate(); }
+    };
+};
+
+
+class RPCGameCoClient {
+public:
+    static constexpr size_t WINDOW = client_window;
+
+    RPCGameCoClient(const std::string& host, const std::string& port);
+    ~RPCGameCoClient();
+
+    void send_try(const char* name, size_t name_len, uint64_t count);
+    void finish();
+
+private:
+    // semaphore
+    //    Counts free window slots. `acquire()` suspends when no slot is
+    //    free; waiters are woken in FIFO order, so requests leave in serial
+    //    order.
+    class semaphore {
+    public:
+        semaphore(RPCGameCoClient& c, size_t n)
+            : _c(c), _count(n) {
+        }
+
+        auto acquire() {
+            struct awaiter {
+                semaphore& s;
+                bool await_ready() noexcept {
+                    if (s._count == 0) {
+                        return false;
+                    }
+                    --s._count;
+                    return true;
+                }
+                void await_suspend(std::coroutine_handle<> h) {
+                    s._waiters.push_back(h);
+                }
+                void await_resume() noexcept {
+                }
+            };
+            return awaiter{*this};
+        }
+
+        // - free a slot, handing it directly to the first waiter if any
+        void release() {
+            if (_waiters.empty()) {
+                ++_count;
+            } else {
+                _c._ready.push_back(_waiters.front());
+                _waiters.pop_front();
+            }
+        }
+
+        size_t available() const {
+            return _count;
+        }
+        size_t waiting() const {
+            return _waiters.size();
+        }
+
+    private:
+        RPCGameCoClient& _c;
+        size_t _count;
+        std::deque<std::coroutine_handle<>> _waiters;
+    };
+
+    // - a task waiting for the response to message `msgid`
+    struct pending_call {
+        std::coroutine_handle<> waiter;
+        clmdep_msgpack::object_handle* result;
+    };
+
+    auto response(uint32_t msgid) {
+        struct awaiter {
+            RPCGameCoClient& c;
+            uint32_t msgid;
+            clmdep_msgpack::object_handle result;
+            bool await_ready() noexcept {
+                return false;
+            }
+            void await_suspend(std::coroutine_handle<> h) {
+                c._calls.emplace(msgid, pending_call{h, &result});
+            }
+            clmdep_msgpack::object_handle await_resume() {
+                return std::move(result);
+            }
+        };
+        return awaiter{*this, msgid, {}};
+    }
+
+    task try_call(uint64_t serial, const char* name, size_t name_len, uint64_t count);
+    task done_call(std::tuple<std::string, std::string>& result, bool& done);
+
+    uint32_t write_request_header(const char* method, size_t method_len, uint32_t nargs);
+    void run_once();
+    void flush();
+    void read_responses();
+    void set_want_write(bool want);
+
+    int _fd;
+    int _epfd;
+    bool _want_write = false;
+
+    uint64_t _serial = 1;
+    uint32_t _msgid = 0;
+    semaphore _window;
+    std::deque<std::coroutine_handle<>> _ready;
+    std::unordered_map<uint32_t, pending_call> _calls;
+
+    clmdep_msgpack::sbuffer _wbuf;
+    size_t _wpos = 0;
+    clmdep_msgpack::unpacker _unpacker;
+
+    std::vector<double> _latencies;     // µs
+
+    NONCOPYABLE(RPCGameCoClient);
+};
+
+RPCGameCoClient::RPCGameCoClient(const std::string& host, const std::string& port)
+    : _window(*this, WINDOW) {
+    struct addrinfo hints = {};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    struct addrinfo* ai;
+    if (int r = getaddrinfo(host.c_str(), port.c_str(), &hints, &ai); r != 0) {
+        std::cerr << host << ":" << port << ": " << gai_strerror(r) << "\n";
+        std::exit(1);
+    }
+    _fd = -1;
+    int err = 0;
+    for (auto a = ai; a && _fd < 0; a = a->ai_next) {
+        _fd = socket(a->ai_family, a->ai_socktype, a->ai_protocol);
+        if (_fd < 0) {
+            err = errno;
+        } else if (connect(_fd, a->ai_addr, a->ai_addrlen) != 0) {
+            err = errno;
+            close(_fd);
+            _fd = -1;
+        }
+    }
+    freeaddrinfo(ai);
+    if (_fd < 0) {
+        std::cerr << host << ":" << port << ": " << strerror(err) << "\n";
+        std::exit(1);
+    }
+
+    int one = 1;
+    setsockopt(_fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    fcntl(_fd, F_SETFL, fcntl(_fd, F_GETFL) | O_NONBLOCK);
+
+    _epfd = epoll_create1(EPOLL_CLOEXEC);
+    struct epoll_event ev = {};
+    ev.events = EPOLLIN;
+    ev.data.fd = _fd;
+    if (_epfd < 0 || epoll_ctl(_epfd, EPOLL_CTL_ADD, _fd, &ev) != 0) {
+        std::cerr << "epoll: " << strerror(errno) << "\n";
+        std::exit(1);
+    }
+}
+
+RPCGameCoClient::~RPCGameCoClient() {
+    close(_epfd);
+    close(_fd);
+}
+
+
+// Calls
+//    Requests are msgpack-RPC frames `[0, msgid, method, [args...]]`,
+//    packed straight into the output buffer without copying the name.
+
+uint32_t RPCGameCoClient::write_request_header(const char* method,
+                                               size_t method_len,
+                                               uint32_t nargs) {
+    uint32_t msgid = _msgid++;
+    clmdep_msgpack::packer<clmdep_msgpack::sbuffer> pk(_wbuf);
+    pk.pack_array(4);
+    pk.pack_uint8(0);
+    pk.pack_uint32(msgid);
+    pk.pack_str(method_len);
+    pk.pack_str_body(method, method_len);
+    pk.pack_array(nargs);
+    return msgid;
+}
+
+task RPCGameCoClient::try_call(uint64_t serial, const char* name,
+                               size_t name_len, uint64_t count) {
+    co_await _window.acquire();
+
+    auto sent = std::chrono::steady_clock::now();
+    uint32_t msgid = write_request_header("Try", 3, 3);
+    clmdep_msgpack::packer<clmdep_msgpack::sbuffer> pk(_wbuf);
+    pk.pack_uint64(serial);
+    pk.pack_str(name_len);
+    pk.pack_str_body(name, name_len);
+    pk.pack_uint64(count);
+
+    auto oh = co_await response(msgid);
+    client_recv_try_response(oh.get().as<uint64_t>());
+    std::chrono::duration<double, std::micro> latency =
+        std::chrono::steady_clock::now() - sent;
+    _latencies.push_back(latency.count());
+
+    _window.release();
+}
+
+task RPCGameCoClient::done_call(std::tuple<std::string, std::string>& result,
+                                bool& done) {
+    uint32_t msgid = write_request_header("Done", 4, 0);
+    auto oh = co_await response(msgid);
+    result = oh.get().as<std::tuple<std::string, std::string>>();
+    done = true;
+}
+
+
+// Event loop
+
+void RPCGameCoClient::run_once() {
+    // resume tasks woken by the previous iteration
+    while (!_ready.empty()) {
+        auto h = _ready.front();
+        _ready.pop_front();
+        h.resume();
+    }
+
+    flush();
+
+    struct epoll_event evs[4];
+    int nev = epoll_wait(_epfd, evs, 4, _ready.empty() ? -1 : 0);
+    if (nev < 0 && errno != EINTR) {
+        std::cerr << "epoll_wait: " << strerror(errno) << "\n";
+        std::exit(1);
+    }
+    for (int i = 0; i < nev; ++i) {
+        if (evs[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR)) {
+            read_responses();
+        }
+        if (evs[i].events & EPOLLOUT) {
+            flush();
+        }
+    }
+}
+
+void RPCGameCoClient::flush() {
+    while (_wpos != _wbuf.size()) {
+        ssize_t w = write(_fd, _wbuf.data() + _wpos, _wbuf.size() - _wpos);
+        if (w > 0) {
+            _wpos += w;
+        } else if (w < 0 && errno == EINTR) {
+            continue;
+        } else if (w < 0 && errno == EAGAIN) {
+            set_want_write(true);
+            return;
+        } else {
+            std::cerr << "write: " << strerror(errno) << "\n";
+            std::exit(1);
+        }
+    }
+    _wbuf.clear();
+    _wpos = 0;
+    set_want_write(false);
+}
+
+void RPCGameCoClient::set_want_write(bool want) {
+    if (want != _want_write) {
+        struct epoll_event ev = {};
+        ev.events = want ? EPOLLIN | EPOLLOUT : EPOLLIN;
+        ev.data.fd = _fd;
+        epoll_ctl(_epfd, EPOLL_CTL_MOD, _fd, &ev);
+        _want_write = want;
+    }
+}
+
+// - responses are `[1, msgid, error, result]`; wake the matching task
+void RPCGameCoClient::read_responses() {
+    while (true) {
+        _unpacker.reserve_buffer(1 << 16);
+        ssize_t r = read(_fd, _unpacker.buffer(), _unpacker.buffer_capacity());
+        if (r < 0 && errno == EINTR) {
+            continue;
+        } else if (r < 0 && errno == EAGAIN) {
+            return;
+        } else if (r <= 0) {
+            std::cerr << "read: " << (r == 0 ? "Connection closed" : strerror(errno)) << "\n";
+            std::exit(1);
+        }
+        _unpacker.buffer_consumed(r);
+
+        clmdep_msgpack::object_handle oh;
+        while (_unpacker.next(oh)) {
+            const clmdep_msgpack::object& msg = oh.get();
+            if (msg.type != clmdep_msgpack::type::ARRAY
+                || msg.via.array.size != 4
+                || msg.via.array.ptr[0].as<int>() != 1) {
+                std::cerr << "Bad response from server\n";
+                std::exit(1);
+            }
+            const auto& error = msg.via.array.ptr[2];
+            if (error.type != clmdep_msgpack::type::NIL) {
+                std::cerr << "RPC failed: " << error << "\n";
+                std::exit(1);
+            }
+            auto it = _calls.find(msg.via.array.ptr[1].as<uint32_t>());
+            if (it == _calls.end()) {
+                std::cerr << "Unexpected response from server\n";
+                std::exit(1);
+            }
+            *it->second.result = clmdep_msgpack::object_handle(
+                msg.via.array.ptr[3], std::move(oh.zone())
+            );
+            _ready.push_back(it->second.waiter);
+            _calls.erase(it);
+        }
+    }
+}
+
+
+// Stub entry points
+
+void RPCGameCoClient::send_try(const char* name, size_t name_len, uint64_t count) {
+    // `name` points into the client's input map, which outlives the task
+    try_call(_serial, name, name_len, count);
+    ++_serial;
+    while (_window.waiting() != 0) {
+        run_once();
+    }
+}
+
+void RPCGameCoClient::finish() {
+    while (_window.available() != WINDOW) {
+        run_once();
+    }
+
+    std::tuple<std::string, std::string> tup;
+    bool done = false;
+    done_call(tup, done);
+    while (!done) {
+        run_once();
+    }
+
+    const std::string& resp_client = std::get<0>(tup);
+    const std::string& resp_server = std::get<1>(tup);
+
+    std::string my_client_checksum = client_checksum();
+    std::string my_server_checksum = server_checksum();
+
+    bool match = (my_client_checksum == resp_client) &&
+                 (my_server_checksum == resp_server);
+
+    std::cout << "client checksums: "
+              << my_client_checksum << "/" << resp_client
+              << "\nserver checksums: "
+              << my_server_checksum << "/" << resp_server
+              << "\nmatch: " << (match ? "true\n" : "false\n");
+
+    if (!_latencies.empty()) {
+        std::sort(_latencies.begin(), _latencies.end());
+        double sum = std::accumulate(_latencies.begin(), _latencies.end(), 0.0);
+        size_t n = _latencies.size();
+        std::cout << std::format("latency: mean {:.0f}us p50 {:.0f}us p99 {:.0f}us\n",
+                                 sum / n, _latencies[n / 2], _latencies[n * 99 / 100]);
+    }
+}
+
+std::unique_ptr<RPCGameCoClient> client;
+
+}
+
+
+// `address` may list several comma-separated replica addresses, as for
+// `rpcg-client`. The coroutine client connects to the first and does not
+// fail over.
+
+void client_connect(std::string address) {
+    address = address.substr(0, address.find(','));
+    auto pos = address.rfind(':');
+    if (pos == std::string::npos) {
+        std::cerr << "Bad address (expected host:port): " << address << "\n";
+        std::exit(1);
+    }
+    client = std::make_unique<RPCGameCoClient>(address.substr(0, pos),
+                                               address.substr(pos + 1));
+}
+
+void client_send_try(const char* name, size_t name_len, uint64_t count) {
+    client->send_try(name, name_len, count);
+}
+
+void client_finish() {
+    client->finish();
+}
@@ -0,0 +1,675 @@
+#include "rpcgame.hh"
+
+#include <rpc/client.h>
+#include <rpc/server.h>
+#include <rpc/msgpack.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdlib>
+#include <deque>
+#include <future>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <unordered_map>
+#include <vector>
+
+// replicastub.cc
+//    Replicated server stub. Three or more replicas agree on batches of Try
+//    requests using the Chandra-Toueg consensus algorithm from
+//    `pset2/ctconsensus.cc`, running one consensus instance per batch over
+//    rpclib connections. Every replica applies every decided batch in
+//    instance order, so all replicas compute the same checksums. A replica
+//    answers a request once the batch containing it has been decided and
+//    applied.
+//
+//    Replicas are crash-stop: a failed replica is never readmitted. When
+//    its contact replica fails, the client resends unanswered requests to
+//    another replica; requests are identified by client serial number, so
+//    a resent request is applied at most once, and a replica that already
+//    applied it answers from its record of recent responses. The group
+//    makes progress as long as a majority of replicas is up.
+
+using steady_clock = std::chrono::steady_clock;
+using namespace std::chrono_literals;
+
+namespace {
+
+enum ct_type {
+    ct_prepare, ct_propose, ct_ack, ct_decide
+};
+
+// - a client request as carried through consensus
+struct ct_request {
+    uint64_t serial;
+    std::string name;
+    uint64_t count;
+    MSGPACK_DEFINE_ARRAY(serial, name, count);
+};
+
+using ct_batch = std::vector<ct_request>;
+
+// - a consensus message; `batch` plays the role of ctconsensus’s color
+struct ct_message {
+    int type;
+    int from;
+    uint64_t instance;
+    uint64_t round;         // all but `ct_decide`
+    uint64_t batch_round;   // only `ct_prepare`
+    bool ack;               // only `ct_ack`
+    ct_batch batch;         // all but `ct_ack`
+    MSGPACK_DEFINE_ARRAY(type, from, instance, round, batch_round, ack, batch);
+};
+
+static inline void parse_address(const std::string& address, std::string& host_out, uint16_t& port_out) {
+    auto pos = address.rfind(':');
+    if (pos == std::string::npos) {
+        std::cerr << "Bad address (expected host:port): " << address << "\n";
+        std::exit(1);
+    }
+    host_out = address.substr(0, pos);
+    port_out = static_cast<uint16_t>(std::stoi(address.substr(pos + 1)));
+}
+
+
+// peer_link
+//    Outgoing connection to another replica. Messages are queued and sent
+//    by a dedicated thread, so a slow or dead peer never blocks consensus.
+//    Chandra–Toueg needs reliable channels between live replicas, so the
+//    thread sends messages in acknowledged batches and removes a batch from
+//    the queue only once the peer has accepted it. On failure it backs off,
+//    reconnects, and resends, so a peer may receive a message twice. A peer
+//    that stays unreachable for `crash_timeout` is declared crashed; its
+//    queue is discarded and later messages are dropped.
+
+class peer_link {
+public:
+    static constexpr size_t max_send = 64;
+    static constexpr auto crash_timeout = 10s;
+
+    peer_link(std::string address) {
+        parse_address(address, _host, _port);
+        _thread = std::thread([this] { run(); });
+    }
+    ~peer_link() {
+        {
+            std::lock_guard<std::mutex> lk(_mu);
+            _stop = true;
+        }
+        _cv.notify_all();
+        _thread.join();
+    }
+
+    void post(const ct_message& m) {
+        {
+            std::lock_guard<std::mutex> lk(_mu);
+            if (_crashed) {
+                return;
+            }
+            _q.push_back(m);
+        }
+        _cv.notify_one();
+    }
+
+private:
+    void run() {
+        std::unique_ptr<rpc::client> cli;
+        steady_clock::time_point retry_at;
+        std::optional<steady_clock::time_point> failing_since;
+        std::vector<ct_message> batch;
+        while (true) {
+            {
+                std::unique_lock<std::mutex> lk(_mu);
+                _cv.wait_until(lk, retry_at, [&] { return _stop; });
+                _cv.wait(lk, [&] { return _stop || !_q.empty(); });
+                if (_stop) {
+                    return;
+                }
+                // copy, not move: the batch stays queued until acknowledged
+                size_t n = std::min(_q.size(), max_send);
+                batch.assign(_q.begin(), _q.begin() + n);
+            }
+            try {
+                if (!cli) {
+                    cli = std::make_unique<rpc::client>(_host, _port);
+                    cli->set_timeout(1000);
+                }
+                cli->call("CT", batch);
+                failing_since.reset();
+                std::lock_guard<std::mutex> lk(_mu);
+                _q.erase(_q.begin(), _q.begin() + batch.size());
+            } catch (const std::exception&) {
+                // back off, then reconnect and resend the batch
+                cli.reset();
+                auto now = steady_clock::now();
+                retry_at = now + 200ms;
+                if (!failing_since) {
+                    failing_since = now;
+                } else if (now - *failing_since >= crash_timeout) {
+                    std::cerr << "Replica " << _host << ":" << _port
+                              << " unreachable, declaring it crashed\n";
+                    std::lock_guard<std::mutex> lk(_mu);
+                    _crashed = true;
+                    _q.clear();
+                    return;
+                }
+            }
+        }
+    }
+
+    std::string _host;
+    uint16_t _port;
+    std::mutex _mu;
+    std::condition_variable _cv;
+    std::deque<ct_message> _q;
+    bool _stop = false;
+    bool _crashed = false;
+    std::thread _thread;
+};
+
+
+// replica
+//    Consensus state for one replica. Client requests enter through
+//    `submit()`, peer messages through `deliver()`; `run()` is the
+//    consensus thread.
+
+class replica {
+public:
+    static constexpr auto failure_timeout = 500ms;
+
+    replica(int id, std::vector<std::string> peers, size_t max_batch);
+
+    uint64_t submit(uint64_t serial, const std::string& name, uint64_t count);
+    void deliver(std::vector<ct_message> ms);
+    void run();
+    void stop();
+    std::string report();
+
+private:
+    struct waiter {
+        std::promise<uint64_t> response;
+        std::shared_future<uint64_t> future;
+        steady_clock::time_point start;
+    };
+    struct counters {
+        uint64_t instances = 0;
+        uint64_t rounds = 0;
+        uint64_t batched = 0;
+    };
+
+    static constexpr size_t max_answered = 1024;   // well over the client window
+
+    int _id;
+    int _N;
+    size_t _max_batch;
+    std::vector<std::unique_ptr<peer_link>> _links;   // null for self
+
+    // shared with RPC handler threads; protected by `_mu`
+    std::mutex _mu;
+    std::condition_variable _cv;
+    std::deque<ct_request> _pending;    // our requests, not yet decided
+    std::unordered_map<uint64_t, waiter> _waiters;  // by serial
+    std::map<uint64_t, uint64_t> _answered; // recent responses, by serial
+    std::deque<ct_message> _inbox;
+    std::atomic<bool> _stop = false;
+    std::vector<double> _latencies;     // µs, submit to response
+    counters _published;                // as of the last applied instance
+
+    // consensus thread only
+    uint64_t _instance = 1;
+    bool _decided;
+    ct_batch _decision;
+    std::deque<ct_message> _stash;
+    std::map<uint64_t, ct_batch> _recent;   // recently decided instances
+    std::map<uint64_t, ct_request> _ready;  // decided, awaiting earlier serials
+    uint64_t _next_serial = 1;              // next serial to apply
+    uint64_t _rounds = 0;
+    uint64_t _batched = 0;
+
+    void send(int to, const ct_message& m);
+    void broadcast(const ct_message& m);
+    bool wait_for_work(ct_batch& estimate);
+    void answer_stale(const ct_message& m);
+    std::optional<ct_message> receive(ct_type type, uint64_t round,
+                                      std::optional<steady_clock::time_point> deadline);
+    void decide(ct_batch batch);
+    ct_batch agree(ct_batch estimate);
+    void apply(const ct_batch& batch);
+
+    NONCOPYABLE(replica);
+};
+
+replica::replica(int id, std::vector<std::string> peers, size_t max_batch)
+    : _id(id), _N(peers.size()), _max_batch(max_batch) {
+    for (int i = 0; i != _N; ++i) {
+        _links.emplace_back(i == _id ? nullptr : new peer_link(peers[i]));
+    }
+}
+
+void replica::send(int to, const ct_message& m) {
+    if (to == _id) {
+        std::lock_guard<std::mutex> lk(_mu);
+        _inbox.push_back(m);
+    } else {
+        _links[to]->post(m);
+    }
+}
+
+void replica::broadcast(const ct_message& m) {
+    for (int j = 0; j != _N; ++j) {
+        send(j, m);
+    }
+}
+
+uint64_t replica::submit(uint64_t serial, const std::string& name, uint64_t count) {
+    std::shared_future<uint64_t> response;
+    {
+        std::lock_guard<std::mutex> lk(_mu);
+        // a request resent after failover may already be answered
+        if (auto it = _answered.find(serial); it != _answered.end()) {
+            return it->second;
+        }
+        auto [it, inserted] = _waiters.try_emplace(serial);
+        if (inserted) {
+            _pending.push_back(ct_request{serial, name, count});
+            it->second.start = steady_clock::now();
+            it->second.future = it->second.response.get_future().share();
+        }
+        response = it->second.future;
+    }
+    _cv.notify_all();
+    return response.get();
+}
+
+void replica::deliver(std::vector<ct_message> ms) {
+    {
+        std::lock_guard<std::mutex> lk(_mu);
+        for (auto& m : ms) {
+            _inbox.push_back(std::move(m));
+        }
+    }
+    _cv.notify_all();
+}
+
+void replica::stop() {
+    {
+        std::lock_guard<std::mutex> lk(_mu);
+        _stop = true;
+    }
+    _cv.notify_all();
+}
+
+
+// Wait until there is something to agree on: either we have pending client
+// requests, or another replica has started the current instance. Sets
+// `estimate` to our initial proposal. Returns false on shutdown.
+
+bool replica::wait_for_work(ct_batch& estimate) {
+    std::vector<ct_message> stale;
+    std::unique_lock<std::mutex> lk(_mu);
+    while (!_stop) {
+        bool active = !_pending.empty();
+        while (!_inbox.empty()) {
+            _stash.push_back(std::move(_inbox.front()));
+            _inbox.pop_front();
+        }
+        for (auto it = _stash.begin(); it != _stash.end(); ) {
+            if (it->instance < _instance) {
+                stale.push_back(std::move(*it));
+                it = _stash.erase(it);
+            } else {
+                active = true;
+                ++it;
+            }
+        }
+        if (!stale.empty()) {
+            lk.unlock();
+            for (auto& m : stale) {
+                answer_stale(m);
+            }
+            stale.clear();
+            lk.lock();
+        } else if (active) {
+            estimate.assign(_pending.begin(),
+                            _pending.begin() + std::min(_pending.size(), _max_batch));
+            return true;
+        } else {
+            _cv.wait(lk);
+        }
+    }
+    return false;
+}
+
+
+// A lagging replica is still working on an instance we decided; tell it
+// the decision.
+
+void replica::answer_stale(const ct_message& m) {
+    auto it = _recent.find(m.instance);
+    if (it != _recent.end() && m.type != ct_decide) {
+        send(m.from, ct_message{ct_decide, _id, m.instance, 0, 0, false, it->second});
+    }
+}
+
+
+// Receive a message of a specific type for the current instance and round.
+// Like `server::receive` in ctconsensus: stash messages for later rounds
+// and instances, ignore old ones, and decide on DECIDE. Returns nullopt if
+// we decided, timed out, or are shutting down.
+
+std::optional<ct_message> replica::receive(ct_type type, uint64_t round,
+                                           std::optional<steady_clock::time_point> deadline) {
+    size_t stash_size = _stash.size();
+
+    while (!_decided) {
+        ct_message m;
+        if (stash_size > 0) {
+            --stash_size;
+            m = std::move(_stash.front());
+            _stash.pop_front();
+        } else {
+            std::unique_lock<std::mutex> lk(_mu);
+            while (_inbox.empty() && !_stop) {
+                if (!deadline) {
+                    _cv.wait(lk);
+                } else if (_cv.wait_until(lk, *deadline) == std::cv_status::timeout
+                           && _inbox.empty()) {
+                    return std::nullopt;
+                }
+            }
+            if (_stop) {
+                return std::nullopt;
+            }
+            m = std::move(_inbox.front());
+            _inbox.pop_front();
+        }
+
+        if (m.instance < _instance) {
+            answer_stale(m);
+            continue;
+        }
+        if (m.instance > _instance) {
+            _stash.push_back(std::move(m));
+            continue;
+        }
+
+        // DECIDE messages cause us to decide
+        if (m.type == ct_decide) {
+            decide(std::move(m.batch));
+            break;
+        }
+
+        // ignore or stash unwanted messages
+        if (m.type != type || m.round != round) {
+            if (m.round >= round) {
+                _stash.push_back(std::move(m));
+            }
+            continue;
+        }
+
+        return m;
+    }
+    return std::nullopt;
+}
+
+
+// Record the decision for the current instance and relay it, so every
+// correct replica learns it even if the deciding leader crashes mid-send.
+
+void replica::decide(ct_batch batch) {
+    _decided = true;
+    _decision = std::move(batch);
+    ct_message m{ct_decide, _id, _instance, 0, 0, false, _decision};
+    for (int j = 0; j != _N; ++j) {
+        if (j != _id) {
+            send(j, m);
+        }
+    }
+}
+
+
+// Run one consensus instance, starting from `estimate`, and return the
+// decided batch. This follows `server::consensus()` in ctconsensus. The
+// coordinator rotates with the instance as well as the round, and at
+// `batch_round` 0 it prefers a nonempty estimate so replicas without
+// client requests do not win with empty batches.
+
+ct_batch replica::agree(ct_batch estimate) {
+    uint64_t round = 1;
+    uint64_t batch_round = 0;
+    _decided = false;
+
+    while (!_decided) {
+        int leader = (_instance + round) % _N;
+        ++_rounds;
+
+        // Phase 1: Send PREPARE to leader
+        send(leader, ct_message{ct_prepare, _id, _instance, round, batch_round, false, estimate});
+
+        // Phase 2: Leader waits to receive PREPAREs from >N/2 replicas,
+        // tracking the latest batch. Peer links may deliver a message
+        // twice, so count distinct senders.
+        if (_id == leader) {
+            std::vector<bool> prepared(_N, false);
+            int received_prepare = 0;
+            while (received_prepare <= _N / 2) {
+                auto m = receive(ct_prepare, round, std::nullopt);
+                if (!m) {
+                    break;
+                } else if (prepared[m->from]) {
+                    continue;
+                }
+                prepared[m->from] = true;
+                ++received_prepare;
+                if (m->batch_round > batch_round
+                    || (m->batch_round == batch_round && estimate.empty())) {
+                    estimate = std::move(m->batch);
+                    batch_round = m->batch_round;
+                }
+            }
+            if (_decided || _stop) {
+                break;
+            }
+
+            // Phase 3: Leader sends PROPOSE to all
+            broadcast(ct_message{ct_propose, _id, _instance, round, 0, false, estimate});
+        }
+
+        // Phase 4: Wait for either leader failure or PROPOSE from leader
+        auto propose = receive(ct_propose, round, steady_clock::now() + failure_timeout);
+        if (_decided || _stop) {
+            break;
+        } else if (propose) {
+            estimate = std::move(propose->batch);
+            batch_round = round;
+        }
+        send(leader, ct_message{ct_ack, _id, _instance, round, 0, (bool) propose, {}});
+
+        // Phase 5: Leader waits for ACKs from >N/2 distinct replicas
+        if (_id == leader) {
+            std::vector<bool> acked(_N, false);
+            int success = 0, total = 0;
+            while (total <= _N / 2) {
+                auto m = receive(ct_ack, round, std::nullopt);
+                if (!m) {
+                    break;
+                } else if (acked[m->from]) {
+                    continue;
+                }
+                acked[m->from] = true;
+                success += m->ack;
+                ++total;
+            }
+            if (_decided || _stop) {
+                break;
+            } else if (success > _N / 2) {
+                // A majority acknowledged our batch! Time to decide.
+                decide(std::move(estimate));
+                break;
+            }
+        }
+
+        // Phase 6: Advance the round and continue
+        ++round;
+    }
+    return std::move(_decision);
+}
+
+
+// Apply a decided batch. Requests are applied at most once, in serial
+// order, as `server_process_try()` requires; a request decided before an
+// earlier serial waits in `_ready`. Responses go back to the RPC handlers
+// waiting in `submit()`, and are kept in `_answered` for a while in case
+// the client resends the request after failing over.
+
+void replica::apply(const ct_batch& batch) {
+    for (auto& r : batch) {
+        if (r.serial >= _next_serial) {
+            _ready.try_emplace(r.serial, r);
+        }
+    }
+    std::vector<std::pair<uint64_t, uint64_t>> responses;
+    while (!_ready.empty() && _ready.begin()->first == _next_serial) {
+        auto& r = _ready.begin()->second;
+        uint64_t value = server_process_try(r.serial, r.name.data(), r.name.size(), r.count);
+        responses.emplace_back(r.serial, value);
+        _ready.erase(_ready.begin());
+        ++_next_serial;
+    }
+    _batched += batch.size();
+
+    std::lock_guard<std::mutex> lk(_mu);
+    std::erase_if(_pending, [&] (const ct_request& r) {
+        return r.serial < _next_serial || _ready.contains(r.serial);
+    });
+    auto now = steady_clock::now();
+    for (auto [serial, value] : responses) {
+        _answered.emplace(serial, value);
+        auto it = _waiters.find(serial);
+        if (it != _waiters.end()) {
+            std::chrono::duration<double, std::micro> latency = now - it->second.start;
+            _latencies.push_back(latency.count());
+            it->second.response.set_value(value);
+            _waiters.erase(it);
+        }
+    }
+    while (_answered.size() > max_answered) {
+        _answered.erase(_answered.begin());
+    }
+    _published = {_instance, _rounds, _batched};
+}
+
+void replica::run() {
+    ct_batch estimate;
+    while (wait_for_work(estimate)) {
+        ct_batch decision = agree(std::move(estimate));
+        if (!_decided) {
+            break;
+        }
+        apply(decision);
+        _recent.emplace(_instance, std::move(decision));
+        if (_recent.size() > 1024) {
+            _recent.erase(_recent.begin());
+        }
+        ++_instance;
+    }
+}
+
+
+// Summarize consensus cost: instances, rounds, batch sizes, and the latency
+// of our own requests.
+
+std::string replica::report() {
+    std::lock_guard<std::mutex> lk(_mu);
+    uint64_t ninstances = _published.instances;
+    auto s = std::format("replica {}: {} instances, {:.2f} rounds/instance, {:.1f} requests/batch\n",
+                         _id, ninstances,
+                         ninstances ? double(_published.rounds) / ninstances : 0.0,
+                         ninstances ? double(_published.batched) / ninstances : 0.0);
+    if (!_latencies.empty()) {
+        std::sort(_latencies.begin(), _latencies.end());
+        double sum = 0;
+        for (double l : _latencies) {
+            sum += l;
+        }
+        size_t n = _latencies.size();
+        s += std::format("replica {}: {} responses, latency mean {:.0f}us p50 {:.0f}us p99 {:.0f}us\n",
+                         _id, n, sum / n, _latencies[n / 2], _latencies[n * 99 / 100]);
+    }
+    return s;
+}
+
+
+static std::unique_ptr<rpc::server> server_ptr;
+static std::unique_ptr<replica> replica_ptr;
+
+}
+
+
+void replica_start(int id, std::vector<std::string> peers,
+                   size_t max_batch, size_t threads) {
+    if (peers.size() < 3 || id < 0 || size_t(id) >= peers.size()) {
+        std::cerr << "Replicated mode needs at least 3 replicas and a valid replica ID\n";
+        std::exit(1);
+    }
+    // Try handlers block until their batch is decided. If every handler
+    // thread held a Try, the CT messages that decide the batch, and the
+    // client's Done, would never run. Keep a thread for each peer and one
+    // for Done beyond the client window.
+    size_t min_threads = client_window + peers.size();
+    if (threads < min_threads) {
+        std::cerr << "Replicated mode needs at least " << min_threads
+                  << " handler threads (`-t`)\n";
+        std::exit(1);
+    }
+    std::string host;
+    uint16_t port = 0;
+    parse_address(peers[id], host, port);
+
+    replica_ptr = std::make_unique<replica>(id, peers, max_batch);
+    server_ptr = std::make_unique<rpc::server>(port);
+
+    server_ptr->bind("Try", [](uint64_t serial, const std::string& name, uint64_t count) -> uint64_t {
+        return replica_ptr->submit(serial, name, count);
+    });
+
+    server_ptr->bind("CT", [](std::vector<ct_message> ms) {
+        replica_ptr->deliver(std::move(ms));
+    });
+
+    server_ptr->bind("Done", []() -> std::tuple<std::string, std::string> {
+        std::string client_csum = client_checksum();
+        std::string server_csum = server_checksum();
+        std::cout << replica_ptr->report();
+
+        static std::once_flag shutdown_once;
+        std::call_once(shutdown_once, [] {
+            std::thread([] {
+                std::this_thread::sleep_for(100ms);
+                replica_ptr->stop();
+                if (server_ptr) {
+                    server_ptr->close_sessions();
+                    server_ptr->stop();
+                }
+            }).detach();
+        });
+
+        return {std::move(client_csum), std::move(server_csum)};
+    });
+
+    std::cout << "Replica " << id << " of " << peers.size()
+              << " listening on " << peers[id] << "\n";
+    // One handler thread per in-flight request also lets large batches form.
+    server_ptr->async_run(threads);
+    replica_ptr->run();
+    std::cout << "Replica exiting\n";
+}
@@ -1,4 +1,5 @@
 #include <cassert>
+#include <algorithm>
 #include <condition_variable>
 #include <getopt.h>
 #include <iostream>
@@ -101,16 +102,38 @@ std::string server_checksum() {
 int main(int argc, char* const argv[]) {
     bool all = false;
     int port = 29381;
+    int replica_id = -1;
+    std::vector<std::string> replicas;
+    size_t max_batch = 256;
+    size_t threads = 160;
     int ch;
-    while ((ch = getopt(argc, argv, "ap:")) != -1) {
+    while ((ch = getopt(argc, argv, "ap:r:R:b:t:")) != -1) {
         if (ch == 'p') {
             port = from_str_chars<uint16_t>(std::string(optarg));
         } else if (ch == 'a') {
             all = true;
+        } else if (ch == 'r') {
+            replica_id = from_str_chars<int>(std::string(optarg));
+        } else if (ch == 'R') {
+            // comma-separated replica addresses, e.g.
+            // `localhost:29381,localhost:29382,localhost:29383`
+            std::string list = optarg;
+            size_t pos = 0;
+            while (pos <= list.size()) {
+                size_t comma = std::min(list.find(',', pos), list.size());
+                replicas.push_back(list.substr(pos, comma - pos));
+                pos = comma + 1;
+            }
+        } else if (ch == 'b') {
+            max_batch = from_str_chars<size_t>(std::string(optarg));
+        } else if (ch == 't') {
+            threads = from_str_chars<size_t>(std::string(optarg));
         }
     }
 
-    if (all) {
+    if (replica_id >= 0 || !replicas.empty()) {
+        replica_start(replica_id, std::move(replicas), max_batch, threads);
+    } else if (all) {
         server_start(std::format("0.0.0.0:{}", port));
     } else {
         server_start(std::format("localhost:{}", port));
@@ -5,8 +5,12 @@
 #include <cstdint>
 #include <format>
 #include <string>
+#include <vector>
 #include "xxhash.h"
 
+// Maximum number of Try RPCs a client stub keeps in flight.
+constexpr size_t client_window = 128;
+
 // Implemented in `clientstub.cc`, called by `client.cc`:
 // - open a connection
 void client_connect(std::string address);
@@ -23,6 +27,15 @@ void client_finish();
 void server_start(std::string address);
 
 
+// Implemented in `replicastub.cc`, called by `server.cc`:
+// - start replica `id` of a replica group whose members listen on
+//   `peers`; replicas agree on batches of at most `max_batch` Try requests
+//   before answering them. `threads` is the number of RPC handler threads.
+//   does not return
+void replica_start(int id, std::vector<std::string> peers,
+                   size_t max_batch, size_t threads);
+
+
 // Implemented in `client.cc`:
 // - account for a received response
 void client_recv_try_response(uint64_t value);
@@ -0,0 +1,364 @@
+#include <algorithm>
+#include <bit>
+#include <cerrno>
+#include <charconv>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <vector>
+#include <unistd.h>
+#include <rpc/msgpack.hpp>
+#include "rpcgame.hh"
+#include "rpcgame.pb.h"
+#include "serialbench.pb.h"
+
+// serialbench.cc
+//    Measure the cost of encoding and decoding Try requests and responses
+//    in each candidate wire format. Requests come from real `lines.txt`
+//    records. Reports ns/op and bytes/op for each format.
+
+namespace {
+
+struct input_line {
+    std::string name;
+    uint64_t count;
+};
+
+std::vector<input_line> read_lines(const char* filename) {
+    std::ifstream f(filename);
+    if (!f) {
+        std::cerr << filename << ": " << strerror(errno) << "\n";
+        exit(1);
+    }
+    std::vector<input_line> lines;
+    std::string line;
+    while (std::getline(f, line)) {
+        auto comma = line.find(',');
+        if (comma == std::string::npos) {
+            continue;
+        }
+        uint64_t count;
+        const char* last = line.data() + line.size();
+        auto [next, ec] = std::from_chars(line.data() + comma + 1, last, count, 10);
+        if (ec == std::errc()) {
+            lines.emplace_back(line.substr(0, comma), count);
+        }
+    }
+    if (lines.empty()) {
+        std::cerr << filename << ": No input records\n";
+        exit(1);
+    }
+    return lines;
+}
+
+// - the response the server would compute for request `serial`
+inline uint64_t response_value(uint64_t serial, const input_line& line) {
+    return XXH3_64bits(line.name.data(), line.name.size()) + line.count + serial;
+}
+
+inline void put_le64(char* s, uint64_t value) {
+    if constexpr (std::endian::native == std::endian::big) {
+        value = std::byteswap(value);
+    }
+    memcpy(s, &value, sizeof(value));
+}
+
+inline uint64_t get_le64(const char* s) {
+    uint64_t value;
+    memcpy(&value, s, sizeof(value));
+    if constexpr (std::endian::native == std::endian::big) {
+        value = std::byteswap(value);
+    }
+    return value;
+}
+
+
+// Formats
+//    Each format encodes into an internal buffer, which is reused across
+//    calls, and returns a view of the encoded bytes. Decoders return a
+//    value derived from every decoded field so the work cannot be
+//    optimized away.
+
+// - `rpcgame.proto` as checked in: integers travel as decimal strings
+class protobuf_string_format {
+public:
+    static constexpr const char* name = "protobuf/string";
+
+    std::string_view encode_request(uint64_t serial, const input_line& line) {
+        char buf[24];
+        auto r = std::to_chars(buf, buf + sizeof(buf), serial);
+        _req.set_serial(buf, r.ptr - buf);
+        _req.set_name(line.name);
+        r = std::to_chars(buf, buf + sizeof(buf), line.count);
+        _req.set_count(buf, r.ptr - buf);
+        _req.SerializeToString(&_buf);
+        return _buf;
+    }
+    uint64_t decode_request(std::string_view s) {
+        _req.ParseFromArray(s.data(), s.size());
+        return from_str_chars<uint64_t>(_req.serial())
+            + from_str_chars<uint64_t>(_req.count())
+            + _req.name().size();
+    }
+    std::string_view encode_response(uint64_t value) {
+        char buf[24];
+        auto r = std::to_chars(buf, buf + sizeof(buf), value);
+        _resp.set_value(buf, r.ptr - buf);
+        _resp.SerializeToString(&_buf);
+        return _buf;
+    }
+    uint64_t decode_response(std::string_view s) {
+        _resp.ParseFromArray(s.data(), s.size());
+        return from_str_chars<uint64_t>(_resp.value());
+    }
+
+private:
+    TryRequest _req;
+    TryResponse _resp;
+    std::string _buf;
+};
+
+// - `serialbench.proto`: integers travel as fixed64
+class protobuf_fixed_format {
+public:
+    static constexpr const char* name = "protobuf/fixed64";
+
+    std::string_view encode_request(uint64_t serial, const input_line& line) {
+        _req.set_serial(serial);
+        _req.set_name(line.name);
+        _req.set_count(line.count);
+        _req.SerializeToString(&_buf);
+        return _buf;
+    }
+    uint64_t decode_request(std::string_view s) {
+        _req.ParseFromArray(s.data(), s.size());
+        return _req.serial() + _req.count() + _req.name().size();
+    }
+    std::string_view encode_response(uint64_t value) {
+        _resp.set_value(value);
+        _resp.SerializeToString(&_buf);
+        return _buf;
+    }
+    uint64_t decode_response(std::string_view s) {
+        _resp.ParseFromArray(s.data(), s.size());
+        return _resp.value();
+    }
+
+private:
+    TryRequestFixed _req;
+    TryResponseFixed _resp;
+    std::string _buf;
+};
+
+// - msgpack-RPC frames exactly as rpclib builds them: a request is
+//   `[0, msgid, "Try", [serial, name, count]]` and a response is
+//   `[1, msgid, nil, value]`. Like `clientstub.cc`, the name is copied
+//   into an owning string before packing.
+class msgpack_format {
+public:
+    static constexpr const char* name = "msgpack/rpclib";
+
+    using request_type = std::tuple<uint8_t, uint32_t, std::string,
+                                    std::tuple<uint64_t, std::string, uint64_t>>;
+    using response_type = std::tuple<uint8_t, uint32_t,
+                                     clmdep_msgpack::type::nil_t, uint64_t>;
+
+    std::string_view encode_request(uint64_t serial, const input_line& line) {
+        _buf.clear();
+        clmdep_msgpack::pack(_buf, std::make_tuple(
+            uint8_t(0), uint32_t(serial), std::string("Try"),
+            std::make_tuple(serial, std::string(line.name), line.count)
+        ));
+        return std::string_view(_buf.data(), _buf.size());
+    }
+    uint64_t decode_request(std::string_view s) {
+        auto oh = clmdep_msgpack::unpack(s.data(), s.size());
+        auto req = oh.get().as<request_type>();
+        auto& args = std::get<3>(req);
+        return std::get<0>(args) + std::get<2>(args) + std::get<1>(args).size();
+    }
+    std::string_view encode_response(uint64_t value) {
+        _buf.clear();
+        clmdep_msgpack::pack(_buf, std::make_tuple(
+            uint8_t(1), uint32_t(value), clmdep_msgpack::type::nil_t(), value
+        ));
+        return std::string_view(_buf.data(), _buf.size());
+    }
+    uint64_t decode_response(std::string_view s) {
+        auto oh = clmdep_msgpack::unpack(s.data(), s.size());
+        return std::get<3>(oh.get().as<response_type>());
+    }
+
+private:
+    clmdep_msgpack::sbuffer _buf;
+};
+
+// - a raw little-endian frame: `[u32 length][u64 serial][u64 count][name]`
+//   for requests and `[u32 length][u64 value]` for responses, where
+//   `length` counts the bytes following the length word
+class raw_format {
+public:
+    static constexpr const char* name = "raw binary";
+
+    std::string_view encode_request(uint64_t serial, const input_line& line) {
+        uint32_t len = 16 + line.name.size();
+        _buf.resize(4 + len);
+        char* s = _buf.data();
+        if constexpr (std::endian::native == std::endian::big) {
+            len = std::byteswap(len);
+        }
+        memcpy(s, &len, 4);
+        put_le64(s + 4, serial);
+        put_le64(s + 12, line.count);
+        memcpy(s + 20, line.name.data(), line.name.size());
+        return _buf;
+    }
+    uint64_t decode_request(std::string_view s) {
+        return get_le64(s.data() + 4) + get_le64(s.data() + 12)
+            + (s.size() - 20);
+    }
+    std::string_view encode_response(uint64_t value) {
+        uint32_t len = 8;
+        _buf.resize(12);
+        if constexpr (std::endian::native == std::endian::big) {
+            len = std::byteswap(len);
+        }
+        memcpy(_buf.data(), &len, 4);
+        put_le64(_buf.data() + 4, value);
+        return _buf;
+    }
+    uint64_t decode_response(std::string_view s) {
+        return get_le64(s.data() + 4);
+    }
+
+private:
+    std::string _buf;
+};
+
+
+// Benchmark driver
+
+using steady_clock = std::chrono::steady_clock;
+
+struct result {
+    double ns[4] = {};          // request encode/decode, response encode/decode
+    double bytes[2] = {};       // request, response
+};
+
+volatile uint64_t sink;
+
+inline double ns_per_op(steady_clock::time_point t0, uint64_t n) {
+    std::chrono::duration<double, std::nano> d = steady_clock::now() - t0;
+    return d.count() / n;
+}
+
+template <typename F>
+result measure(const std::vector<input_line>& lines, uint64_t n) {
+    F f;
+    result r;
+    uint64_t nl = lines.size();
+    uint64_t check = 0, nbytes = 0;
+
+    // encoded copies of every request and response, for the decoders
+    std::vector<std::string> reqs, resps;
+    for (uint64_t i = 0; i != nl; ++i) {
+        reqs.emplace_back(f.encode_request(i + 1, lines[i]));
+        resps.emplace_back(f.encode_response(response_value(i + 1, lines[i])));
+    }
+
+    auto t0 = steady_clock::now();
+    for (uint64_t i = 0; i != n; ++i) {
+        auto s = f.encode_request(i + 1, lines[i % nl]);
+        nbytes += s.size();
+        check += s.back();
+    }
+    r.ns[0] = ns_per_op(t0, n);
+    r.bytes[0] = double(nbytes) / n;
+
+    t0 = steady_clock::now();
+    for (uint64_t i = 0; i != n; ++i) {
+        check += f.decode_request(reqs[i % nl]);
+    }
+    r.ns[1] = ns_per_op(t0, n);
+
+    nbytes = 0;
+    t0 = steady_clock::now();
+    for (uint64_t i = 0; i != n; ++i) {
+        auto s = f.encode_response(i * 0x9E3779B97F4A7C15ULL);
+        nbytes += s.size();
+        check += s.back();
+    }
+    r.ns[2] = ns_per_op(t0, n);
+    r.bytes[1] = double(nbytes) / n;
+
+    t0 = steady_clock::now();
+    for (uint64_t i = 0; i != n; ++i) {
+        check += f.decode_response(resps[i % nl]);
+    }
+    r.ns[3] = ns_per_op(t0, n);
+
+    sink = check;
+    return r;
+}
+
+// - run `rounds` measurements and keep the fastest time for each column
+template <typename F>
+void run(const std::vector<input_line>& lines, uint64_t n, int rounds) {
+    result best = measure<F>(lines, n);
+    for (int i = 1; i < rounds; ++i) {
+        result r = measure<F>(lines, n);
+        for (int j = 0; j != 4; ++j) {
+            best.ns[j] = std::min(best.ns[j], r.ns[j]);
+        }
+    }
+    std::cout << std::format("{:<18} {:>9.1f} {:>9.1f} {:>9.1f} {:>9.1f} {:>8.1f} {:>8.1f}\n",
+                             F::name, best.ns[0], best.ns[1], best.ns[2], best.ns[3],
+                             best.bytes[0], best.bytes[1]);
+}
+
+}
+
+
+// main program
+
+int main(int argc, char* const argv[]) {
+    GOOGLE_PROTOBUF_VERIFY_VERSION;
+
+    uint64_t n = 1000000;
+    int rounds = 3;
+    const char* filename = "lines.txt";
+    int ch;
+    while ((ch = getopt(argc, argv, "n:r:f:")) != -1) {
+        if (ch == 'n') {
+            n = from_str_chars<uint64_t>(optarg);
+        } else if (ch == 'r') {
+            rounds = from_str_chars<int>(optarg);
+        } else if (ch == 'f') {
+            filename = optarg;
+        }
+    }
+    if (n == 0 || rounds < 1) {
+        std::cerr << "serialbench: `-n` and `-r` must be at least 1\n";
+        exit(1);
+    }
+
+    auto lines = read_lines(filename);
+    std::cerr << std::format("{} records from {}, {} ops per measurement, best of {}\n",
+                             lines.size(), filename, n, rounds);
+
+    std::cout << std::format("{:<18} {:>9} {:>9} {:>9} {:>9} {:>8} {:>8}\n",
+                             "format", "req enc", "req dec", "resp enc", "resp dec",
+                             "req B", "resp B");
+    std::cout << std::format("{:<18} {:>9} {:>9} {:>9} {:>9} {:>8} {:>8}\n",
+                             "", "ns/op", "ns/op", "ns/op", "ns/op", "B/op", "B/op");
+    run<protobuf_string_format>(lines, n, rounds);
+    run<protobuf_fixed_format>(lines, n, rounds);
+    run<msgpack_format>(lines, n, rounds);
+    run<raw_format>(lines, n, rounds);
+
+    google::protobuf::ShutdownProtobufLibrary();
+}
@@ -1,4 +1,5 @@
 #pragma once
+#include <algorithm>
 #include <atomic>
 #include <cassert>
 #include <chrono>
@@ -7,15 +8,31 @@
 #include <exception>
 #include <memory>
 #include <optional>
+#include <ranges>
+#include <string>
 #include <utility>
 #include <variant>
 #include <vector>
-#include "detail/timer_heap.hh"
+#if __linux__
+#include <sys/socket.h>
+#endif
+#include "detail/pool.hh"
+#include "detail/profile.hh"
+#include "detail/listener.hh"
+#include "detail/refcount.hh"
+#include "detail/ring_buffer.hh"
+#include "detail/timer_wheel.hh"
 #include "detail/event_handle.hh"
 
 // cotamer.hh
 //    Public interface to the Cotamer coroutine library.
 
+// Define COTAMER_DIRECT_TRANSFER to 1 to let a coroutine that suspends back to
+// the event loop switch straight to the next ready coroutine (see `driver`).
+#ifndef COTAMER_DIRECT_TRANSFER
+#define COTAMER_DIRECT_TRANSFER 0
+#endif
+
 namespace cotamer {
 
 // event
@@ -107,6 +124,20 @@ struct clearing_error {};
 template <typename... Es> inline event any(Es&&... es);
 template <typename... Es> inline event all(Es&&... es);
 
+// Runtime-sized forms take a sized range of events, such as a
+// `std::span<event>` or `std::vector<event>`.
+// any(range) — triggers when any event in the range triggers.
+// all(range) — triggers when all events in the range have triggered.
+// at_least(k, range) — triggers when `k` events in the range have triggered.
+template <typename R>
+concept event_range = std::ranges::sized_range<R>
+    && std::convertible_to<std::ranges::range_reference_t<R>, const event&>;
+
+template <event_range R> inline event any(R&& r);
+template <event_range R> inline event all(R&& r);
+template <event_range R> inline event at_least(size_t k, R&& r);
+
+
 // attempt(task, events...) — race a task against events. Returns the task's
 // result (wrapped in optional) if the task completes first, or nullopt if
 // one of the events triggers first.
@@ -118,6 +149,117 @@ template <typename... Es>
 task<std::optional<bool>> attempt(task<void> t, Es&&... es);
 
 
+// countdown
+//    A countdown latch: an event that triggers once `count_down()` has been
+//    called `n` times. Copies share the same count. A countdown is lighter
+//    than `all()` over `n` separate events: it is a single event body.
+
+class countdown {
+public:
+    explicit inline countdown(size_t n);
+
+    inline void count_down(size_t k = 1);
+    inline size_t remaining() const noexcept;
+
+    inline event completion() const;
+
+private:
+    detail::event_handle ep_;
+};
+
+
+// notifier
+//    A reusable wakeup signal, like a condition variable. `co_await
+//    n.wait()` suspends the calling task until the next `notify_one()` or
+//    `notify_all()`. A notification wakes only tasks already waiting, so wait
+//    in a loop that checks a condition. Unlike an event, a notifier can be
+//    used any number of times, and it never allocates: each waiting task
+//    links itself into the notifier from its own coroutine frame. Waiters
+//    wake in the order they started waiting. Destroying a notifier wakes its
+//    waiters.
+
+class notifier {
+public:
+    inline notifier() noexcept;
+    notifier(const notifier&) = delete;
+    notifier(notifier&&) = delete;
+    notifier& operator=(const notifier&) = delete;
+    notifier& operator=(notifier&&) = delete;
+    inline ~notifier();
+
+    inline detail::notifier_awaiter wait() noexcept;
+    inline bool notify_one();       // returns true if a task was woken
+    inline void notify_all();
+
+    inline bool idle() const noexcept;   // no task is waiting
+
+private:
+    detail::listener_link waiters_;
+};
+
+
+// channel<T>
+//    An awaitable FIFO queue for passing values between tasks, with any
+//    number of senders and receivers. `co_await ch.push(x)` appends `x`,
+//    waiting while the channel is full; `co_await ch.pop()` removes and
+//    returns the first value, waiting while the channel is empty; and
+//    `co_await ch.pop_all(v)` waits for a value, then moves every available
+//    value onto the end of `v` and returns how many it moved. `try_push` and
+//    `try_pop` never wait. Waiting tasks are served in FIFO order.
+//
+//    A channel is unbounded by default; `channel<T>(n)` holds at most `n`
+//    values, and `channel<T>(0)` makes each push wait for a matching pop.
+//    Values are kept in a ring buffer, and a value pushed while a task waits
+//    to pop goes straight to that task, so a channel that has reached its
+//    working size does not allocate. Destroying a channel wakes its waiting
+//    tasks, which is only safe while the driver is clearing.
+
+template <typename T>
+class channel {
+public:
+    static constexpr size_t unbounded = size_t(-1);
+
+    explicit inline channel(size_t capacity = unbounded);
+    channel(const channel<T>&) = delete;
+    channel(channel<T>&&) = delete;
+    channel<T>& operator=(const channel<T>&) = delete;
+    channel<T>& operator=(channel<T>&&) = delete;
+    inline ~channel();
+
+    inline detail::channel_push_awaiter<T> push(T x);
+    inline detail::channel_pop_awaiter<T> pop() noexcept;
+    inline detail::channel_pop_all_awaiter<T> pop_all(std::vector<T>& out) noexcept;
+
+    inline bool try_push(T&& x);        // moves from `x` only on success
+    inline bool try_push(const T& x);
+    inline std::optional<T> try_pop();
+
+    size_t size() const noexcept {
+        return q_.size();
+    }
+    bool empty() const noexcept {
+        return q_.empty();
+    }
+    size_t capacity() const noexcept {
+        return capacity_;
+    }
+
+private:
+    friend struct detail::channel_push_awaiter<T>;
+    friend struct detail::channel_popper<T>;
+    friend struct detail::channel_pop_awaiter<T>;
+    friend struct detail::channel_pop_all_awaiter<T>;
+
+    ring_buffer<T> q_;
+    size_t capacity_;
+    detail::listener_link pushers_;
+    detail::listener_link poppers_;
+
+    bool give(T& x);
+    bool take(std::optional<T>& v);
+};
+
+
 // Time and scheduling functions (operate on driver::main).
 using clock = std::chrono::system_clock;
 inline clock::time_point now();
@@ -129,7 +271,94 @@ inline event at(clock::time_point);    // triggers at an absolute time
 
 inline void loop();                    // run event loop until quiescent
 inline void clear();                   // cancel all pending events
-void reset();                          // destroy and recreate driver
+
+// Driver clocks: `simulated` virtual time, or `real_time` (see `driver`).
+enum class driver_mode { simulated, real_time };
+void reset(driver_mode = driver_mode::simulated);  // destroy and recreate driver
+
+// File descriptor readiness (real-time drivers only).
+inline event readable(int fd);         // triggers when `fd` is readable
+inline event writable(int fd);         // triggers when `fd` is writable
+inline void forget_fd(int fd);         // trigger `fd`’s events; call before close
+
+#if __linux__
+// Asynchronous I/O through io_uring (real-time drivers on Linux). Operations
+// started by one loop iteration are submitted together. `co_await` yields the
+// system call’s result, or `-errno`; buffers must stay valid until then.
+namespace io {
+inline detail::io_awaiter read(int fd, void* buf, size_t n, uint64_t offset = -1);
+inline detail::io_awaiter write(int fd, const void* buf, size_t n, uint64_t offset = -1);
+inline detail::io_awaiter recv(int fd, void* buf, size_t n, int flags = 0);
+inline detail::io_awaiter send(int fd, const void* buf, size_t n, int flags = 0);
+inline detail::io_awaiter accept(int fd, sockaddr* addr = nullptr,
+                                 socklen_t* addrlen = nullptr, int flags = 0);
+inline detail::io_awaiter connect(int fd, const sockaddr* addr, socklen_t addrlen);
+}
+#endif
+
+// Allocation counts for this thread’s event body and coroutine frame pool.
+inline const detail::pool_counters& pool_stats();
+
+// Statistics for this thread’s drivers (see `driver_counters`).
+struct driver_counters;
+inline driver_counters driver_stats();
+
+
+// driver_counters
+//    Statistics kept by each thread’s drivers, cheap enough to leave on.
+//    `driver_stats()` returns them, accumulated over every driver the thread
+//    has run (`reset()` does not clear them). `report()` formats them for
+//    printing, and `+=` combines counters from several threads.
+
+struct driver_counters {
+    uint64_t resumptions = 0;       // coroutines resumed by the loop
+    uint64_t asap_triggers = 0;     // `asap()` events triggered
+    uint64_t timers_inserted = 0;
+    uint64_t timers_fired = 0;
+    uint64_t timers_cancelled = 0;  // removed early: no longer observable
+    uint64_t timers_culled = 0;     // removed lazily: already dead
+    uint64_t timer_peak = 0;        // largest timer queue
+    uint64_t ready_peak = 0;        // longest ready queue
+    int64_t live_events = 0;        // event bodies allocated and not freed
+    int64_t live_frames = 0;        // task frames allocated and not freed
+    uint64_t loops = 0;             // calls to `loop()` and `loop_until()`
+    std::chrono::nanoseconds loop_time{0};  // real time spent in them
+
+    driver_counters& operator+=(const driver_counters& x);
+    std::string report() const;
+};
+
+// task_profile
+//    Per-task profile for this thread, built with COTAMER_PROFILE (see
+//    `detail/profile.hh`). `cotamer::profile()` returns one entry per task
+//    function: resumptions and real time spent in them. `report()` prints a
+//    flat profile (by time) and a resumption table (by count), and `+=`
+//    combines profiles from several threads.
+
+struct task_profile {
+    struct entry {
+        std::string task;                   // coroutine function name
+        std::string location;               // file:line
+        uint64_t resumptions = 0;
+        std::chrono::nanoseconds time{0};
+    };
+
+    bool enabled = COTAMER_PROFILE;
+    std::vector<entry> entries;
+
+    task_profile& operator+=(const task_profile& x);
+    std::string report() const;
+};
+
+task_profile profile();
+
+
+namespace detail {
+inline driver_counters& local_driver_counters() noexcept {
+    thread_local constinit driver_counters c{};
+    return c;
+}
+}
 
 
 // driver
@@ -138,12 +367,33 @@ void reset();                          // destroy and recreate driver
 //    Time is simulated: the clock advances by one tick per coroutine
 //    resumption, and jumps forward to the next timer when idle.
 //
-//    A single global driver is stored in `driver::main`. The free functions
-//    `now()`, `after()`, `loop()`, etc. delegate to it.
+//    Each thread has its own driver, stored in `driver::main`. The free
+//    functions `now()`, `after()`, `loop()`, etc. delegate to it. Events and
+//    coroutines belong to the driver of the thread that created them.
+//
+//    With COTAMER_DIRECT_TRANSFER, a coroutine resumed by the loop that
+//    suspends while other coroutines are ready resumes the first of them by
+//    symmetric transfer, rather than returning to the loop, which would
+//    resume that same coroutine next. The transfer does the loop’s
+//    bookkeeping (one clock tick per resumption), so scheduling order and
+//    virtual time are unchanged. Chains are limited to `max_transfers`.
+//    Profiling (COTAMER_PROFILE) times each resumption separately, so it
+//    disables direct transfer.
+//
+//    A `driver_mode::real_time` driver runs the same tasks against the real
+//    clock. `now()` starts at the system clock’s time and advances with the
+//    steady clock, refreshed after every resumption; when there is nothing to
+//    run, the loop sleeps until the next timer or until a file descriptor
+//    awaited with `readable()` or `writable()` becomes ready
+//    (`detail/poller.hh`). `loop()` returns once no timers are pending and no
+//    task can observe an fd event; `loop_until(limit)` also returns when the
+//    real time reaches `limit`. `clear()` fires all timers and fd events at
+//    once. On Linux, `io::` operations run on an io_uring (`detail/uring.hh`);
+//    the loop submits them and harvests their completions once per iteration.
 
 class driver {
 public:
-    driver();
+    explicit driver(driver_mode mode = driver_mode::simulated);
     ~driver();
     driver(const driver&) = delete;
     driver(driver&&) = delete;
@@ -160,23 +410,62 @@ public:
     inline void after(clock::duration d, event);
     inline event after(clock::duration d);
 
+    inline driver_mode mode() const;
+    event readable(int fd);
+    event writable(int fd);
+    void forget_fd(int fd);
+
     void loop();
     void clear();
 
+    // Windowed execution, for conservative parallel simulation. `next_time()`
+    // returns the time of the earliest pending work (`time_point::max()` if
+    // none). `loop_until(limit)` runs everything before `limit`; it returns
+    // true if `clear()` was called, in which case it drains like `loop()`.
+    clock::time_point next_time();
+    bool loop_until(clock::time_point limit);
+
     // introspection
     inline size_t timer_size() const;
+    inline const timer_counters& timer_stats() const;
+    inline size_t ready_size() const;
+    driver_counters stats() const;      // this thread’s counters
 
-    static std::unique_ptr<driver> main;
-    static bool clearing;
+    static thread_local std::unique_ptr<driver> main;
+    static thread_local constinit bool clearing;
+    static inline driver& current();       // `*main`, but faster
 
 private:
     friend struct detail::event_body;
+    friend class detail::event_handle;
+    template <typename T> friend struct detail::task_awaiter;
     template <typename T> friend struct detail::task_event_awaiter;
+    template <typename T> friend struct detail::task_final_awaiter;
+    friend struct detail::waiter;
+    friend struct detail::io_awaiter;
+
+    static constexpr bool profiling = COTAMER_PROFILE;
+    static constexpr bool direct_transfer = COTAMER_DIRECT_TRANSFER && !profiling;
+    static constexpr unsigned max_transfers = 64;
 
-    std::deque<std::coroutine_handle<>> ready_;
-    std::deque<event> asap_;
-    timer_heap<detail::event_handle> timed_;
+    ring_buffer<std::coroutine_handle<>> ready_;
+    ring_buffer<event> asap_;
+    timer_queue<detail::event_handle> timed_;
     clock::time_point now_;
+    std::unique_ptr<detail::poller> poller_;    // real-time drivers only
+
+    static thread_local constinit driver* current_;
+
+    // coroutine resumed by the loop, while it runs (for direct transfer)
+    void* resumed_ = nullptr;
+    unsigned transfers_ = 0;
+
+    inline void cancel_timer(unsigned i, const detail::event_body* eb);
+    inline void make_ready(std::coroutine_handle<> ch);
+    inline void resume(std::coroutine_handle<> ch);
+    inline std::coroutine_handle<> transfer_from(void* self);
+    inline void pass_resumed(void* from, void* to);
+    bool loop_real_time(clock::time_point limit);
 };
 
 }
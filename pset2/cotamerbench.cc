@@ -0,0 +1,486 @@
+#include "cotamer.hh"
+#include "utils.hh"
+#include <algorithm>
+#include <array>
+#include <functional>
+#include <vector>
+#include <print>
+
+// cotamerbench.cc
+//    Microbenchmarks for the Cotamer runtime. Each benchmark reports ns per
+//    operation: the median and minimum of `-r` runs of `-n` operations
+//    (scaled down for expensive operations). The table has a fixed set of
+//    rows, so runs before and after a change can be compared line by line.
+
+namespace cot = cotamer;
+using namespace std::chrono_literals;
+using steady_clock = std::chrono::steady_clock;
+
+volatile uintptr_t sink;
+
+static double elapsed_ns(steady_clock::time_point t0, uint64_t n) {
+    std::chrono::duration<double, std::nano> d = steady_clock::now() - t0;
+    return d.count() / n;
+}
+
+
+// - events
+
+static double event_create(uint64_t n) {
+    auto t0 = steady_clock::now();
+    for (uint64_t i = 0; i != n; ++i) {
+        cot::event e;
+        sink = reinterpret_cast<uintptr_t>(e.handle().get());
+    }
+    return elapsed_ns(t0, n);
+}
+
+static double event_create_trigger(uint64_t n) {
+    auto t0 = steady_clock::now();
+    for (uint64_t i = 0; i != n; ++i) {
+        cot::event e;
+        e.trigger();
+    }
+    return elapsed_ns(t0, n);
+}
+
+static double event_copy(uint64_t n) {
+    std::array<cot::event, 64> es;
+    std::array<cot::event, 64> copies;
+    auto t0 = steady_clock::now();
+    for (uint64_t i = 0; i != n; ++i) {
+        copies[i % 64] = es[(i * 7) % 64];
+    }
+    return elapsed_ns(t0, n);
+}
+
+
+// - co_await
+
+cot::task<> await_triggered(uint64_t n, double& result) {
+    cot::event e;
+    e.trigger();
+    auto t0 = steady_clock::now();
+    for (uint64_t i = 0; i != n; ++i) {
+        co_await e;
+    }
+    result = elapsed_ns(t0, n);
+}
+
+// two tasks hand control back and forth: each handoff is one trigger, one
+// suspension, and one resumption through the driver
+cot::task<> ping_pong(cot::event* mine, cot::event* theirs, uint64_t n) {
+    for (uint64_t i = 0; i != n; ++i) {
+        *mine = cot::event();
+        theirs->trigger();
+        co_await *mine;
+    }
+    theirs->trigger();
+}
+
+static double await_handoff(uint64_t n) {
+    cot::reset();
+    cot::event a, b;
+    auto t0 = steady_clock::now();
+    ping_pong(&a, &b, n / 2).detach();
+    ping_pong(&b, &a, n / 2).detach();
+    cot::loop();
+    return elapsed_ns(t0, n);
+}
+
+// the same handoff, but on two reusable notifiers
+cot::task<> ping_pong_notifier(cot::notifier* mine, cot::notifier* theirs,
+                               bool* turn, bool me, uint64_t n) {
+    for (uint64_t i = 0; i != n; ++i) {
+        while (*turn != me) {
+            co_await mine->wait();
+        }
+        *turn = !me;
+        theirs->notify_one();
+    }
+}
+
+static double notifier_handoff(uint64_t n) {
+    cot::reset();
+    cot::notifier a, b;
+    bool turn = false;
+    auto t0 = steady_clock::now();
+    ping_pong_notifier(&a, &b, &turn, false, n / 2).detach();
+    ping_pong_notifier(&b, &a, &turn, true, n / 2).detach();
+    cot::loop();
+    return elapsed_ns(t0, n);
+}
+
+// a producer and a consumer connected by a channel with room for K values
+cot::task<> channel_producer(cot::channel<uint64_t>& ch, uint64_t n) {
+    for (uint64_t i = 0; i != n; ++i) {
+        co_await ch.push(i);
+    }
+}
+
+cot::task<> channel_consumer(cot::channel<uint64_t>& ch, uint64_t n) {
+    for (uint64_t i = 0; i != n; ++i) {
+        sink = co_await ch.pop();
+    }
+}
+
+template <size_t K>
+static double channel_transfer(uint64_t n) {
+    cot::reset();
+    cot::channel<uint64_t> ch(K);
+    auto t0 = steady_clock::now();
+    channel_consumer(ch, n).detach();
+    channel_producer(ch, n).detach();
+    cot::loop();
+    return elapsed_ns(t0, n);
+}
+
+cot::task<> wait_on(cot::event e) {
+    co_await e;
+}
+
+// K tasks wait on one event, which then triggers; reports ns per waiter
+template <size_t K>
+static double await_broadcast(uint64_t n) {
+    cot::reset();
+    n = std::max<uint64_t>(n / K, 1) * K;
+    auto t0 = steady_clock::now();
+    for (uint64_t i = 0; i != n; i += K) {
+        cot::event e;
+        for (size_t j = 0; j != K; ++j) {
+            wait_on(e).detach();
+        }
+        e.trigger();
+        cot::loop();
+    }
+    return elapsed_ns(t0, n);
+}
+
+static double await_triggered_ns(uint64_t n) {
+    cot::reset();
+    double result = 0;
+    await_triggered(n, result).detach();
+    cot::loop();
+    return result;
+}
+
+
+// - any/all
+
+template <size_t K, size_t... I>
+static cot::event make_any(std::array<cot::event, K>& es, std::index_sequence<I...>) {
+    return cot::any(es[I]...);
+}
+
+template <size_t K, size_t... I>
+static cot::event make_all(std::array<cot::event, K>& es, std::index_sequence<I...>) {
+    return cot::all(es[I]...);
+}
+
+// create a K-member any(), then trigger one member
+template <size_t K>
+static double any_trigger(uint64_t n) {
+    auto t0 = steady_clock::now();
+    for (uint64_t i = 0; i != n; ++i) {
+        std::array<cot::event, K> es;
+        auto q = make_any(es, std::make_index_sequence<K>());
+        es[i % K].trigger();
+        sink = q.triggered();
+    }
+    return elapsed_ns(t0, n);
+}
+
+// create a K-member all(), then trigger every member
+template <size_t K>
+static double all_trigger(uint64_t n) {
+    auto t0 = steady_clock::now();
+    for (uint64_t i = 0; i != n; ++i) {
+        std::array<cot::event, K> es;
+        auto q = make_all(es, std::make_index_sequence<K>());
+        for (auto& e : es) {
+            e.trigger();
+        }
+        sink = q.triggered();
+    }
+    return elapsed_ns(t0, n);
+}
+
+// create an at_least(K/2 + 1) over a runtime-sized range of K events, then
+// trigger every member
+template <size_t K>
+static double at_least_trigger(uint64_t n) {
+    std::vector<cot::event> es(K);
+    auto t0 = steady_clock::now();
+    for (uint64_t i = 0; i != n; ++i) {
+        for (auto& e : es) {
+            e = cot::event();
+        }
+        auto q = cot::at_least(K / 2 + 1, es);
+        for (auto& e : es) {
+            e.trigger();
+        }
+        sink = q.triggered();
+    }
+    return elapsed_ns(t0, n);
+}
+
+// count a K-count countdown down to zero
+template <size_t K>
+static double countdown_trigger(uint64_t n) {
+    auto t0 = steady_clock::now();
+    for (uint64_t i = 0; i != n; ++i) {
+        cot::countdown c(K);
+        for (size_t j = 0; j != K; ++j) {
+            c.count_down();
+        }
+        sink = c.completion().triggered();
+    }
+    return elapsed_ns(t0, n);
+}
+
+
+// - tasks
+
+cot::task<> empty_task() {
+    co_return;
+}
+
+cot::task<int> value_task(int x) {
+    co_return x + 1;
+}
+
+cot::task<> asap_task() {
+    co_await cot::asap();
+}
+
+static double task_spawn_detach(uint64_t n) {
+    auto t0 = steady_clock::now();
+    for (uint64_t i = 0; i != n; ++i) {
+        empty_task().detach();
+    }
+    return elapsed_ns(t0, n);
+}
+
+cot::task<> spawn_await(uint64_t n, double& result) {
+    int x = 0;
+    auto t0 = steady_clock::now();
+    for (uint64_t i = 0; i != n; ++i) {
+        x = co_await value_task(x);
+    }
+    result = elapsed_ns(t0, n);
+    sink = x;
+}
+
+static double task_spawn_await(uint64_t n) {
+    cot::reset();
+    double result = 0;
+    spawn_await(n, result).detach();
+    cot::loop();
+    return result;
+}
+
+// spawn detached tasks that suspend once, then run them to completion
+static double task_spawn_suspend(uint64_t n) {
+    cot::reset();
+    auto t0 = steady_clock::now();
+    for (uint64_t i = 0; i != n; ++i) {
+        asap_task().detach();
+    }
+    cot::loop();
+    return elapsed_ns(t0, n);
+}
+
+
+// - attempt
+
+cot::task<> attempt_complete(uint64_t n, double& result) {
+    cot::event never;
+    auto t0 = steady_clock::now();
+    for (uint64_t i = 0; i != n; ++i) {
+        auto r = co_await cot::attempt(value_task(int(i)), never);
+        sink = *r;
+    }
+    result = elapsed_ns(t0, n);
+}
+
+cot::task<int> wait_for(cot::event e) {
+    co_await e;
+    co_return 0;
+}
+
+cot::task<> attempt_timeout(uint64_t n, double& result) {
+    cot::event never;
+    auto t0 = steady_clock::now();
+    for (uint64_t i = 0; i != n; ++i) {
+        auto r = co_await cot::attempt(wait_for(never), cot::after(1ms));
+        sink = r.has_value();
+    }
+    result = elapsed_ns(t0, n);
+}
+
+template <cot::task<> (*F)(uint64_t, double&)>
+static double run_task_bench(uint64_t n) {
+    cot::reset();
+    double result = 0;
+    F(n, result).detach();
+    cot::loop();
+    return result;
+}
+
+
+// - timers
+//   `pending` long timers stay in the queue while we measure
+
+static std::vector<cot::event> prefill(size_t pending) {
+    std::vector<cot::event> v;
+    v.reserve(pending);
+    for (size_t i = 0; i != pending; ++i) {
+        v.push_back(cot::after(1000h + std::chrono::microseconds(i)));
+    }
+    return v;
+}
+
+static double timer_insert(uint64_t n, size_t pending) {
+    cot::reset();
+    auto keep = prefill(pending);
+    std::vector<cot::event> timers;
+    timers.reserve(n);
+    auto t0 = steady_clock::now();
+    for (uint64_t i = 0; i != n; ++i) {
+        timers.push_back(cot::after(std::chrono::microseconds(i % 997 + 1)));
+    }
+    double result = elapsed_ns(t0, n);
+    cot::reset();
+    return result;
+}
+
+cot::task<> timer_sleeper(uint64_t n, double& result) {
+    auto t0 = steady_clock::now();
+    for (uint64_t i = 0; i != n; ++i) {
+        co_await cot::after(1us);
+    }
+    result = elapsed_ns(t0, n);
+    cot::clear();
+}
+
+static double timer_fire(uint64_t n, size_t pending) {
+    cot::reset();
+    auto keep = prefill(pending);
+    double result = 0;
+    timer_sleeper(n, result).detach();
+    cot::loop();
+    return result;
+}
+
+
+// - reset
+
+static double reset_empty(uint64_t n) {
+    auto t0 = steady_clock::now();
+    for (uint64_t i = 0; i != n; ++i) {
+        cot::reset();
+    }
+    return elapsed_ns(t0, n);
+}
+
+static double reset_with_timers(uint64_t n) {
+    // reset a driver with 100 pending timers and 100 suspended tasks
+    double total = 0;
+    for (uint64_t i = 0; i != n; ++i) {
+        for (int j = 0; j != 100; ++j) {
+            [] () -> cot::task<> { co_await cot::after(1h); }().detach();
+        }
+        auto t0 = steady_clock::now();
+        cot::reset();
+        total += elapsed_ns(t0, 1);
+    }
+    return total / n;
+}
+
+
+struct benchmark {
+    std::string name;
+    std::function<double(uint64_t)> run;
+    uint64_t divisor = 1;   // run `n / divisor` operations
+};
+
+static std::vector<benchmark> benchmarks() {
+    std::vector<benchmark> b;
+    b.push_back({"event create", event_create});
+    b.push_back({"event create+trigger", event_create_trigger});
+    b.push_back({"event copy-assign", event_copy});
+    b.push_back({"co_await triggered", await_triggered_ns});
+    b.push_back({"co_await handoff", await_handoff});
+    b.push_back({"co_await broadcast, 64 waiters", await_broadcast<64>});
+    b.push_back({"notifier handoff", notifier_handoff});
+    b.push_back({"channel(0) push+pop", channel_transfer<0>});
+    b.push_back({"channel(64) push+pop", channel_transfer<64>});
+    b.push_back({"any(2) + trigger", any_trigger<2>});
+    b.push_back({"any(8) + trigger", any_trigger<8>, 4});
+    b.push_back({"any(64) + trigger", any_trigger<64>, 32});
+    b.push_back({"all(2) + trigger", all_trigger<2>});
+    b.push_back({"all(8) + trigger", all_trigger<8>, 4});
+    b.push_back({"all(64) + trigger", all_trigger<64>, 32});
+    b.push_back({"at_least(33 of 64) + trigger", at_least_trigger<64>, 32});
+    b.push_back({"countdown(64)", countdown_trigger<64>, 4});
+    b.push_back({"attempt, completes", run_task_bench<attempt_complete>, 4});
+    b.push_back({"attempt, times out", run_task_bench<attempt_timeout>, 4});
+    b.push_back({"task spawn+detach", task_spawn_detach});
+    b.push_back({"task spawn+await", task_spawn_await});
+    b.push_back({"task spawn+suspend", task_spawn_suspend});
+    for (size_t pending : {0, 1000, 100000, 1000000}) {
+        b.push_back({std::format("timer insert, {} pending", pending), [pending] (uint64_t n) {
+            return timer_insert(n, pending);
+        }, 4});
+        b.push_back({std::format("timer fire, {} pending", pending), [pending] (uint64_t n) {
+            return timer_fire(n, pending);
+        }, 4});
+    }
+    b.push_back({"reset, empty", reset_empty, 4});
+    b.push_back({"reset, 100 tasks", reset_with_timers, 1000});
+    return b;
+}
+
+
+static struct option options[] = {
+    { "count", required_argument, nullptr, 'n' },
+    { "runs", required_argument, nullptr, 'r' },
+    { "filter", required_argument, nullptr, 'f' },
+    { nullptr, 0, nullptr, 0 }
+};
+
+int main(int argc, char* argv[]) {
+    uint64_t n = 1000000;
+    int runs = 5;
+    std::string filter;
+
+    auto shortopts = short_options_for(options);
+    int ch;
+    while ((ch = getopt_long(argc, argv, shortopts.c_str(), options, nullptr)) != -1) {
+        if (ch == 'n') {
+            n = from_str_chars<uint64_t>(optarg);
+        } else if (ch == 'r') {
+            runs = std::max(from_str_chars<int>(optarg), 1);
+        } else if (ch == 'f') {
+            filter = optarg;
+        } else {
+            std::print(std::cerr, "Unknown option\n");
+            return 1;
+        }
+    }
+
+    std::print("{:<32} {:>12} {:>12}\n", "benchmark", "median ns", "min ns");
+    for (auto& b : benchmarks()) {
+        if (!filter.empty() && b.name.find(filter) == std::string::npos) {
+            continue;
+        }
+        uint64_t count = std::max<uint64_t>(n / b.divisor, 1);
+        std::vector<double> t;
+        for (int r = 0; r != runs; ++r) {
+            t.push_back(b.run(count));
+        }
+        std::sort(t.begin(), t.end());
+        std::print("{:<32} {:>12.1f} {:>12.1f}\n", b.name, t[t.size() / 2], t[0]);
+    }
+    cot::reset();
+}
@@ -2,7 +2,9 @@
 #include "netsim.hh"
 #include "ctconsensus_msgs.hh"
 #include <list>
+#include <mutex>
 #include <print>
+#include <thread>
 #include <cassert>
 #ifdef _WIN32
 #include "detail/getopt_win.h"
@@ -49,6 +51,10 @@ struct server {
         : id_(id), N_(N), net_(net), my_port_(net.input(id_)), color_(color) {
     }
 
+    int id() const {
+        return id_;
+    }
+
     cot::task<> consensus();
 
 private:
@@ -226,19 +232,20 @@ cot::task<> server::consensus() {
 
 // Nancy is a distinguished observer that collects DECIDE messages
 // and validates that (1) all servers agree on the same color, and
-// (2) the consensus color is valid for this initialization.
+// (2) the consensus color is valid for this initialization. She sets
+// `approves` to true if so.
 
-bool nancy_approves = false;
 bool nancy_be_quiet = false;
 
 cot::task<> nancy_is_impatient();
 
-cot::task<> nancy(port<message>& my_port, int N, std::string required_consensus) {
+cot::task<> nancy(port<message>& my_port, int N, std::string required_consensus,
+                  bool& approves) {
     int received = 0;
     std::string consensus;
 
     // Nancy initially disapproves.
-    nancy_approves = false;
+    approves = false;
 
     // It's an error if we don't achieve consensus in 15 minutes.
     nancy_is_impatient().detach();
@@ -282,7 +289,7 @@ cot::task<> nancy(port<message>& my_port, int N, std::string required_consensus)
     if (!nancy_be_quiet) {
         std::print("*** CONSENSUS ACHIEVED *** {} x \"{}\"\n", received, consensus);
     }
-    nancy_approves = true;
+    approves = true;
 
 done:
     // cancel all outstanding tasks and end the event loop
@@ -302,6 +309,16 @@ cot::task<> nancy_is_impatient() {
 // Main entry point
 
 static int N = 3;
+static int nworkers = 1;
+static int njobs = 1;
+static bool print_stats = false;
+static bool print_profile = false;
+static unsigned long branch_count = 0;
+static std::optional<unsigned long> branch_seed;
+static cot::clock::duration branch_time = 1s;
+static random_log* draw_log = nullptr;
+
+static void run_branches(ctconsensus::network_type& net, bool& approves);
 
 static bool try_one_seed(ctconsensus::network_type& net,
                          std::optional<unsigned long> seed) {
@@ -311,6 +328,7 @@ static bool try_one_seed(ctconsensus::network_type& net,
     if (seed) {
         net.randomness().seed(*seed);
     }
+    net.randomness().set_log(draw_log);
 
     // start N servers, each with a random initial color
     std::list<ctconsensus::server> servers;
@@ -323,16 +341,133 @@ static bool try_one_seed(ctconsensus::network_type& net,
             required_consensus = "";
         }
         servers.emplace_back(i, N, net, color);
-        servers.back().consensus().detach();
+        if (nworkers == 1) {
+            servers.back().consensus().detach();
+        }
     }
 
     // start Nancy, who collects DECIDE messages and validates them
-    ctconsensus::nancy(net.input(ctconsensus::nancy_id), N, required_consensus)
-        .detach();
+    bool approves = false;
+    auto& nancy_port = net.input(ctconsensus::nancy_id);
+    if (nworkers == 1) {
+        ctconsensus::nancy(nancy_port, N, required_consensus, approves).detach();
+        if (branch_count > 0 || branch_seed) {
+            run_branches(net, approves);
+        } else {
+            cot::loop();
+        }
+    } else {
+        // each partition starts its own servers (and perhaps Nancy)
+        net.run_parallel(nworkers, [&] (int p) {
+            for (auto& s : servers) {
+                if (net.partition_of(s.id()) == p) {
+                    s.consensus().detach();
+                }
+            }
+            if (net.partition_of(ctconsensus::nancy_id) == p) {
+                ctconsensus::nancy(nancy_port, N, required_consensus, approves)
+                    .detach();
+            }
+        });
+    }
+
+    net.randomness().set_log(nullptr);
+    return approves;
+}
+
+
+// Branch exploration
+//    `-b COUNT` runs the simulation for `-t` milliseconds of virtual time,
+//    then explores COUNT random continuations of it in forked processes,
+//    `-j` at a time, and reports those that fail. `-B SEED` replays one of
+//    those continuations in this process; it needs the same `-S` and `-t`
+//    (without `-S`, `-b` picks a run seed and prints it).
 
+static void run_branches(ctconsensus::network_type& net, bool& approves) {
+    auto when = cot::now() + branch_time;
+    if (branch_seed) {
+        if (!cot::driver::current().loop_until(when)) {
+            net.randomness().seed(*branch_seed);
+            cot::loop();
+        }
+        return;
+    }
+
+    auto branches = net.explore(when, branch_count, [&] () {
+        return approves ? 0 : 1;
+    }, njobs);
+    if (branches.empty()) {
+        return;     // finished before `when`; `approves` is set
+    }
+    // abandon our own continuation
+    cot::clear();
     cot::loop();
 
-    return ctconsensus::nancy_approves;
+    size_t failures = 0;
+    for (auto& b : branches) {
+        if (b.status != 0) {
+            if (failures < 10) {
+                std::print(std::cerr, "*** FAILURE on branch seed {} (status {})\n",
+                           b.seed, b.status);
+            }
+            ++failures;
+        }
+    }
+    if (failures > 0 || !ctconsensus::nancy_be_quiet) {
+        std::print(std::cerr, "{} of {} branches failed\n", failures, branches.size());
+    }
+    approves = failures == 0;
+}
+
+
+// Seed sweeps
+//    `-R COUNT -j J` runs COUNT seeds on J threads, each with its own network
+//    (and, since drivers are thread-local, its own driver). Seeds are drawn
+//    from `generator` in order as they are claimed, so seed i is the same as
+//    in a sequential sweep. A thread stops claiming seeds once one at a lower
+//    index has failed; the first failure in seed order is reported.
+
+struct seed_sweep {
+    seed_sweep(std::mt19937_64& generator, unsigned long count)
+        : generator(generator), count(count) {
+    }
+
+    std::mutex mutex;
+    std::mt19937_64& generator;
+    unsigned long count;
+    unsigned long next = 0;           // index of next seed to claim
+    std::optional<unsigned long> first_failure;  // index of failing seed
+    unsigned long failing_seed = 0;
+    unsigned long finished = 0;
+    cot::driver_counters stats;       // from threads other than main
+    cot::task_profile profile;
+};
+
+static void sweep_seeds(seed_sweep& sw, ctconsensus::network_type& net) {
+    while (true) {
+        unsigned long i, seed;
+        {
+            std::lock_guard lock(sw.mutex);
+            if (sw.next == sw.count
+                || (sw.first_failure && sw.next > *sw.first_failure)) {
+                return;
+            }
+            i = sw.next++;
+            seed = sw.generator();
+        }
+
+        bool ok = try_one_seed(net, seed);
+
+        std::lock_guard lock(sw.mutex);
+        if (!ok && (!sw.first_failure || i < *sw.first_failure)) {
+            sw.first_failure = i;
+            sw.failing_seed = seed;
+        }
+        ++sw.finished;
+        if (sw.finished % 1000 == 0 && ctconsensus::nancy_be_quiet) {
+            std::print(std::cerr, ".");
+        }
+    }
 }
 
 
@@ -342,6 +477,16 @@ static struct option options[] = {
     { "random-seeds", required_argument, nullptr, 'R' },
     { "verbose", no_argument, nullptr, 'V' },
     { "quiet", no_argument, nullptr, 'q' },
+    { "parallel", required_argument, nullptr, 'P' },
+    { "jobs", required_argument, nullptr, 'j' },
+    { "stats", no_argument, nullptr, 's' },
+    { "profile", no_argument, nullptr, 'p' },
+    { "branches", required_argument, nullptr, 'b' },
+    { "branch-seed", required_argument, nullptr, 'B' },
+    { "branch-time", required_argument, nullptr, 't' },
+    { "record", required_argument, nullptr, 'W' },
+    { "replay", required_argument, nullptr, 'L' },
+    { "trace", required_argument, nullptr, 'T' },
     { nullptr, 0, nullptr, 0 }
 };
 
@@ -351,10 +496,24 @@ int main(int argc, char* argv[]) {
 
     // Read program options: `-n N` sets the number of servers, `-S SEED` sets
     // the desired random seed, and `-R COUNT` runs COUNT times with different
-    // random seeds, exiting on the first problem.
+    // random seeds, exiting on the first problem (with `-S`, the seeds are
+    // drawn from a generator seeded with SEED). `-P W` runs each simulation
+    // on W threads (results are deterministic per seed and W), and `-j J`
+    // spreads `-R` seeds across J threads. `-s` prints driver statistics at
+    // exit, and `-p` prints a per-task profile (in COTAMER_PROFILE builds);
+    // with `-P`, these cover partition 0 only. `-b COUNT` explores COUNT
+    // forked continuations of the run from `-t MS` milliseconds of virtual
+    // time (default 1000), and `-B SEED` replays one of them. `-W FILE`
+    // records the run's random draws to FILE, and `-L FILE` replays them
+    // (see `random_log` in netsim.hh). `-T EVENTS` records the last EVENTS
+    // message events in memory, then prints them in `-V` format at exit;
+    // it is much faster than `-V` for large runs.
     // Add more options by extending the `options` structure.
     std::optional<unsigned long> first_seed;
     unsigned long seed_count = 0;
+    const char* record_path = nullptr;
+    const char* replay_path = nullptr;
+    size_t trace_capacity = 0;
 
     auto shortopts = short_options_for(options);
     int ch;
@@ -372,31 +531,132 @@ int main(int argc, char* argv[]) {
             net.set_verbose(true);
         } else if (ch == 'q') {
             ctconsensus::nancy_be_quiet = true;
+        } else if (ch == 'P') {
+            nworkers = from_str_chars<int>(optarg);
+            if (nworkers < 1) {
+                throw std::invalid_argument("`-P` must be 1 or more");
+            }
+        } else if (ch == 's') {
+            print_stats = true;
+        } else if (ch == 'p') {
+            print_profile = true;
+        } else if (ch == 'b') {
+            branch_count = from_str_chars<unsigned long>(optarg);
+        } else if (ch == 'B') {
+            branch_seed = from_str_chars<unsigned long>(optarg);
+        } else if (ch == 't') {
+            branch_time = std::chrono::milliseconds(from_str_chars<unsigned long>(optarg));
+        } else if (ch == 'W') {
+            record_path = optarg;
+        } else if (ch == 'L') {
+            replay_path = optarg;
+        } else if (ch == 'T') {
+            trace_capacity = from_str_chars<size_t>(optarg);
+        } else if (ch == 'j') {
+            njobs = from_str_chars<int>(optarg);
+            if (njobs < 1) {
+                throw std::invalid_argument("`-j` must be 1 or more");
+            }
         } else {
             std::print(std::cerr, "Unknown option\n");
             return 1;
         }
     }
 
+    if ((branch_count > 0 || branch_seed) && (seed_count > 0 || nworkers > 1)) {
+        throw std::invalid_argument("`-b` and `-B` cannot be combined with `-R` or `-P`");
+    }
+    if (branch_seed && !first_seed) {
+        throw std::invalid_argument("`-B` requires the run's `-S` seed");
+    }
+    if (branch_count > 0 && !first_seed) {
+        // branch seeds are only replayable with the run seed, so pick one
+        first_seed = randomly_seeded<std::mt19937_64>()();
+        std::print(std::cerr, "run seed {}\n", *first_seed);
+    }
+    if ((record_path || replay_path)
+        && (seed_count > 0 || nworkers > 1 || branch_count > 0)) {
+        throw std::invalid_argument("`-W` and `-L` cannot be combined with `-R`, `-P`, or `-b`");
+    }
+    if (trace_capacity > 0
+        && (seed_count > 0 || nworkers > 1 || branch_count > 0)) {
+        throw std::invalid_argument("`-T` cannot be combined with `-R`, `-P`, or `-b`");
+    }
+    net.set_trace(trace_capacity);
+    random_log log;
+    size_t replay_size = 0;
+    if (replay_path) {
+        log = random_log::load(replay_path);
+        replay_size = log.entries().size();
+    }
+    if (record_path || replay_path) {
+        draw_log = &log;
+    }
+
     bool ok;
+    cot::driver_counters stats;
+    cot::task_profile profile;
     if (seed_count > 0) {
         std::mt19937_64 seed_generator = randomly_seeded<std::mt19937_64>();
-        for (unsigned long i = 0; i != seed_count; ++i) {
-            if (i > 0 && i % 1000 == 0 && ctconsensus::nancy_be_quiet) {
-                std::print(std::cerr, ".");
+        if (first_seed) {
+            // `-S` with `-R` makes the sweep reproducible
+            seed_generator.seed(*first_seed);
+        }
+        seed_sweep sw(seed_generator, seed_count);
+        if (njobs == 1) {
+            sweep_seeds(sw, net);
+        } else {
+            std::vector<std::thread> threads;
+            for (int j = 0; j != njobs; ++j) {
+                threads.emplace_back([&] () {
+                    ctconsensus::network_type thread_net;
+                    thread_net.set_verbose(net.verbose());
+                    sweep_seeds(sw, thread_net);
+                    std::lock_guard lock(sw.mutex);
+                    sw.stats += cot::driver_stats();
+                    sw.profile += cot::profile();
+                });
             }
-            unsigned long seed = seed_generator();
-            ok = try_one_seed(net, seed);
-            if (!ok) {
-                std::print(std::cerr, "*** FAILURE on seed {}\n", seed);
-                break;
+            for (auto& t : threads) {
+                t.join();
             }
         }
+        stats += sw.stats;
+        profile += sw.profile;
+        ok = !sw.first_failure;
+        if (!ok) {
+            std::print(std::cerr, "*** FAILURE on seed {}\n", sw.failing_seed);
+        }
         if (ok && seed_count >= 1000 && ctconsensus::nancy_be_quiet) {
             std::print(std::cerr, "\n");
         }
     } else {
         ok = try_one_seed(net, first_seed);
     }
+    if (auto trace = net.trace()) {
+        trace->print();
+        if (trace->dropped() > 0) {
+            std::print(std::cerr, "trace dropped {} earliest events\n", trace->dropped());
+        }
+    }
+    if (replay_path) {
+        std::print(std::cerr, "replayed {} of {} draws",
+                   std::min(log.position(), replay_size), replay_size);
+        if (auto d = log.diverged()) {
+            std::print(std::cerr, "; diverged at draw {}", *d);
+        }
+        std::print(std::cerr, "\n");
+    }
+    if (record_path) {
+        log.save(record_path);
+    }
+    if (print_stats) {
+        stats += cot::driver_stats();
+        std::print(std::cerr, "{}", stats.report());
+    }
+    if (print_profile) {
+        profile += cot::profile();
+        std::print(std::cerr, "{}", profile.report());
+    }
     return ok ? EXIT_SUCCESS : EXIT_FAILURE;
 }
@@ -1,28 +1,69 @@
 #include "cotamer.hh"
+#include "detail/poller.hh"
+#include <algorithm>
+#include <format>
 #include <memory>
+#include <stdexcept>
+#include <string_view>
 
 namespace cotamer {
 
-std::unique_ptr<driver> driver::main{new driver};
-bool driver::clearing = false;
+thread_local std::unique_ptr<driver> driver::main{new driver};
+thread_local constinit bool driver::clearing = false;
+thread_local constinit driver* driver::current_ = nullptr;
 
-driver::driver()
+driver::driver(driver_mode mode)
     : now_(std::chrono::system_clock::from_time_t(1634070069)) {
+    if (mode == driver_mode::real_time) {
+        poller_.reset(new detail::poller);
+        now_ = poller_->now();
+    }
 }
 
 driver::~driver() {
-    if (!asap_.empty() || !ready_.empty() || !timed_.empty()) {
+    if (!asap_.empty() || !ready_.empty() || !timed_.empty()
+        || (poller_ && poller_->live())) {
         // Clear any remaining events and coroutines
         std::unique_ptr<driver> tmp(this);
         tmp.swap(main);
+        current_ = this;
         clear();
         loop();
         tmp.swap(main);
         tmp.release();
     }
+    current_ = nullptr;     // reload from `main` on next use
+
+    // fold this driver’s timer counts into the thread’s
+    auto& c = detail::local_driver_counters();
+    c.timers_inserted += timed_.stats().inserted;
+    c.timers_cancelled += timed_.stats().cancelled;
+    c.timers_culled += timed_.stats().culled;
 }
 
 void driver::loop() {
+    loop_until(clock::time_point::max());
+}
+
+clock::time_point driver::next_time() {
+    if (!asap_.empty() || !ready_.empty()) {
+        return now_;
+    }
+    timed_.cull();
+    return timed_.empty() ? clock::time_point::max() : timed_.top_time();
+}
+
+bool driver::loop_until(clock::time_point limit) {
+    if (poller_) [[unlikely]] {
+        return loop_real_time(limit);
+    }
+    auto& c = detail::local_driver_counters();
+    auto t0 = std::chrono::steady_clock::now();
+    // `limit == max()` means no limit, so even timers at `max()` fire
+    auto before_limit = [&] (clock::time_point t) {
+        return t < limit || limit == clock::time_point::max();
+    };
+    bool cleared = false;
     bool again = true;
     while (again) {
         again = false;
@@ -30,38 +71,288 @@ void driver::loop() {
         while (!asap_.empty()) {
             asap_.front().trigger();
             asap_.pop_front();
+            ++c.asap_triggers;
             again = true;
         }
 
         while (!ready_.empty()) {
             auto ch = ready_.front();
             ready_.pop_front();
-            ch();
+            resume(ch);
             now_ += clock::duration{1};
             again = true;
         }
 
-        // update time
+        // after `clear()`, drain everything regardless of `limit`
+        if (clearing) {
+            cleared = true;
+            limit = clock::time_point::max();
+        }
+
+        // update time, but not past `limit`
         timed_.cull();
-        if (asap_.empty() && !timed_.empty()) {
+        if (asap_.empty() && !timed_.empty() && before_limit(timed_.top_time())) {
             now_ = timed_.top_time();
         }
 
-        while (!timed_.empty() && timed_.top_time() <= now_) {
-            timed_.top()->trigger();
-            timed_.pop();
+        while (!timed_.empty() && timed_.top_time() <= now_
+               && before_limit(timed_.top_time())) {
+            timed_.take_top()->trigger();
+            ++c.timers_fired;
             again = true;
         }
     }
     clearing = false;
+    ++c.loops;
+    c.loop_time += std::chrono::steady_clock::now() - t0;
+    return cleared;
+}
+
+// driver::loop_real_time(limit)
+//    The loop for real-time drivers. Runs ready work, reading the real
+//    clock after each resumption; submits I/O started by that work and
+//    collects finished I/O; fires due timers; and otherwise sleeps in the
+//    poller until the next timer, `limit`, fd readiness, or I/O completion.
+//    Returns like `loop_until`.
+
+bool driver::loop_real_time(clock::time_point limit) {
+    auto& c = detail::local_driver_counters();
+    auto t0 = std::chrono::steady_clock::now();
+    bool cleared = false;
+    while (true) {
+        while (!asap_.empty()) {
+            asap_.front().trigger();
+            asap_.pop_front();
+            ++c.asap_triggers;
+        }
+
+        while (!ready_.empty()) {
+            auto ch = ready_.front();
+            ready_.pop_front();
+            resume(ch);
+            now_ = std::max(now_, poller_->now());
+        }
+        poller_->flush();
+        now_ = std::max(now_, poller_->now());
+
+        if (clearing) {
+            // fire everything now, in order; don’t wait
+            cleared = true;
+            poller_->clear();
+            for (timed_.cull(); !timed_.empty(); timed_.cull()) {
+                timed_.take_top()->trigger();
+                ++c.timers_fired;
+            }
+            if (asap_.empty() && ready_.empty()) {
+                break;
+            }
+            continue;
+        }
+
+        timed_.cull();
+        bool fired = false;
+        while (!timed_.empty() && timed_.top_time() <= now_
+               && timed_.top_time() < limit) {
+            timed_.take_top()->trigger();
+            ++c.timers_fired;
+            fired = true;
+        }
+        if (fired || !asap_.empty() || !ready_.empty()) {
+            continue;
+        }
+
+        if (now_ >= limit || (timed_.empty() && !poller_->live())) {
+            break;
+        }
+        poller_->wait(timed_.empty() ? limit : std::min(timed_.top_time(), limit));
+    }
+    if (cleared) {
+        clearing = false;
+    }
+    ++c.loops;
+    c.loop_time += std::chrono::steady_clock::now() - t0;
+    return cleared;
 }
 
 void driver::clear() {
     clearing = true;
 }
 
-void reset() {
-    driver::main.reset(new driver);
+event driver::readable(int fd) {
+    if (!poller_) {
+        throw std::logic_error("cotamer::readable requires a real-time driver");
+    }
+    return event(poller_->watch(fd, false));
+}
+
+event driver::writable(int fd) {
+    if (!poller_) {
+        throw std::logic_error("cotamer::writable requires a real-time driver");
+    }
+    return event(poller_->watch(fd, true));
+}
+
+void driver::forget_fd(int fd) {
+    if (poller_) {
+        poller_->forget(fd);
+    }
+}
+
+driver_counters driver::stats() const {
+    auto c = detail::local_driver_counters();
+    c.timers_inserted += timed_.stats().inserted;
+    c.timers_cancelled += timed_.stats().cancelled;
+    c.timers_culled += timed_.stats().culled;
+    return c;
+}
+
+void reset(driver_mode mode) {
+    driver::main.reset(new driver(mode));
+}
+
+
+driver_counters& driver_counters::operator+=(const driver_counters& x) {
+    resumptions += x.resumptions;
+    asap_triggers += x.asap_triggers;
+    timers_inserted += x.timers_inserted;
+    timers_fired += x.timers_fired;
+    timers_cancelled += x.timers_cancelled;
+    timers_culled += x.timers_culled;
+    timer_peak = std::max(timer_peak, x.timer_peak);
+    ready_peak = std::max(ready_peak, x.ready_peak);
+    live_events += x.live_events;
+    live_frames += x.live_frames;
+    loops += x.loops;
+    loop_time += x.loop_time;
+    return *this;
+}
+
+std::string driver_counters::report() const {
+    std::chrono::duration<double> secs = loop_time;
+    double rate = secs.count() > 0 ? resumptions / secs.count() : 0.0;
+    return std::format(
+        "resumptions {}, asap triggers {}\n"
+        "timers: {} inserted, {} fired, {} cancelled, {} culled, peak {}\n"
+        "ready queue peak {}\n"
+        "live: {} events, {} task frames\n"
+        "loop: {} calls, {:.3f} s real time, {:.0f} resumptions/sec\n",
+        resumptions, asap_triggers,
+        timers_inserted, timers_fired, timers_cancelled, timers_culled, timer_peak,
+        ready_peak, live_events, live_frames,
+        loops, secs.count(), rate);
+}
+
+
+// task_profile
+
+namespace {
+// Shorten a `function_name()`, such as “cotamer::task<> ns::f(int) [with
+// ...]”, to the qualified function name (“ns::f”).
+std::string short_task_name(std::string_view fn) {
+    int depth = 0;
+    size_t start = 0;
+    for (size_t i = 0; i != fn.size(); ++i) {
+        char ch = fn[i];
+        if (ch == '<') {
+            ++depth;
+        } else if (ch == '>') {
+            --depth;
+        } else if (ch == ' ' && depth == 0) {
+            start = i + 1;
+        } else if (ch == '(' && depth == 0 && i > start) {
+            return std::string(fn.substr(start, i - start));
+        }
+    }
+    return std::string(fn);
+}
+
+void merge_entry(std::vector<task_profile::entry>& entries,
+                 const task_profile::entry& e) {
+    for (auto& x : entries) {
+        if (x.task == e.task && x.location == e.location) {
+            x.resumptions += e.resumptions;
+            x.time += e.time;
+            return;
+        }
+    }
+    entries.push_back(e);
+}
+}
+
+task_profile profile() {
+    task_profile p;
+    auto& tags = detail::profiler::local().tags();
+    for (size_t i = 0; i != tags.size(); ++i) {
+        auto& t = tags[i];
+        if (t.resumptions == 0) {
+            continue;
+        }
+        task_profile::entry e;
+        if (i == detail::profiler::unknown) {
+            e.task = "(unknown)";
+        } else {
+            e.task = short_task_name(t.location.function_name());
+            std::string_view file = t.location.file_name();
+            if (auto slash = file.rfind('/'); slash != file.npos) {
+                file = file.substr(slash + 1);
+            }
+            e.location = std::format("{}:{}", file, t.location.line());
+        }
+        e.resumptions = t.resumptions;
+        e.time = t.time;
+        merge_entry(p.entries, e);
+    }
+    return p;
+}
+
+task_profile& task_profile::operator+=(const task_profile& x) {
+    enabled = enabled || x.enabled;
+    for (auto& e : x.entries) {
+        merge_entry(entries, e);
+    }
+    return *this;
+}
+
+std::string task_profile::report() const {
+    if (!enabled) {
+        return "task profile unavailable: build with COTAMER_PROFILE=1\n";
+    }
+    std::chrono::nanoseconds total_time{0};
+    uint64_t total_resumptions = 0;
+    for (auto& e : entries) {
+        total_time += e.time;
+        total_resumptions += e.resumptions;
+    }
+    auto pct = [] (double x, double total) {
+        return total > 0 ? 100.0 * x / total : 0.0;
+    };
+    auto label = [] (const entry& e) {
+        return e.location.empty() ? e.task : std::format("{} ({})", e.task, e.location);
+    };
+    auto es = entries;
+    std::string out = std::format("{:>10} {:>6} {:>11} {:>10}  {}\n",
+                                  "time ms", "%", "resumes", "ns/resume", "task");
+    std::sort(es.begin(), es.end(), [] (auto& a, auto& b) {
+        return a.time > b.time;
+    });
+    for (auto& e : es) {
+        out += std::format("{:>10.3f} {:>5.1f}% {:>11} {:>10.0f}  {}\n",
+                           e.time.count() / 1e6,
+                           pct(e.time.count(), total_time.count()),
+                           e.resumptions,
+                           double(e.time.count()) / e.resumptions,
+                           label(e));
+    }
+    out += std::format("\n{:>11} {:>6}  {}\n", "resumes", "%", "task");
+    std::sort(es.begin(), es.end(), [] (auto& a, auto& b) {
+        return a.resumptions > b.resumptions;
+    });
+    for (auto& e : es) {
+        out += std::format("{:>11} {:>5.1f}%  {}\n",
+                           e.resumptions, pct(e.resumptions, total_resumptions),
+                           label(e));
+    }
+    return out;
 }
 
 
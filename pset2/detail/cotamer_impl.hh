@@ -8,12 +8,13 @@
 namespace cotamer {
 namespace detail {
 
-// mark a listener as a quorum
+// mark a listener as a quorum member
 constexpr uintptr_t lf_quorum = uintptr_t(1);
 
 // event_body::flags_
 constexpr uint32_t f_quorum = 1;        // this is a quorum_event_body
 constexpr uint32_t f_want_interest = 2; // a transitive quorum member needs interest{}
+constexpr uint32_t f_triggered = 4;     // this event has triggered
 constexpr uint32_t f_interest = 16;     // this quorum has 1 interest{}
                                         // (added once per interest{})
 
@@ -29,6 +30,22 @@ constexpr uint32_t f_interest = 16;     // this quorum has 1 interest{}
 
 template <typename T>
 struct task_promise {
+    // The promise must not be an aggregate. The runtime first tries to
+    // construct the promise from the coroutine’s arguments; for an aggregate,
+    // that would initialize our members from those arguments!
+#if COTAMER_PROFILE
+    // - Tag the task with its coroutine function, for the profiler
+    task_promise(std::source_location loc = std::source_location::current()) noexcept
+        : location_(loc) {
+    }
+    ~task_promise() {
+        profiler::local().remove_task(std::coroutine_handle<task_promise<T>>::from_promise(*this).address());
+    }
+    std::source_location location_;
+#else
+    task_promise() noexcept = default;
+#endif
+
     // Functions required by the C++ runtime
     // - Initialize the task<T> return value that manages the coroutine:
     inline task<T> get_return_object() noexcept;
@@ -48,6 +65,16 @@ struct task_promise {
     // - Export coroutine return value to `co_await`er:
     inline T result();
 
+    // - Allocate coroutine frames from the thread’s pool:
+    static void* operator new(size_t sz) {
+        ++local_driver_counters().live_frames;
+        return pool::local().allocate(sz);
+    }
+    static void operator delete(void* p, size_t sz) noexcept {
+        --local_driver_counters().live_frames;
+        pool::local().deallocate(p, sz);
+    }
+
     // Our own additions
     inline event_handle& make_interest();
     bool detached_ = false;
@@ -60,7 +87,11 @@ struct task_promise {
 
 template <typename T>
 inline task<T> task_promise<T>::get_return_object() noexcept {
-    return task<T>{std::coroutine_handle<task_promise<T>>::from_promise(*this)};
+    auto h = std::coroutine_handle<task_promise<T>>::from_promise(*this);
+#if COTAMER_PROFILE
+    profiler::local().add_task(h.address(), location_);
+#endif
+    return task<T>{h};
 }
 
 template <typename T>
@@ -77,6 +108,18 @@ T task_promise<T>::result() {
 
 template <>
 struct task_promise<void> {
+#if COTAMER_PROFILE
+    task_promise(std::source_location loc = std::source_location::current()) noexcept
+        : location_(loc) {
+    }
+    ~task_promise() {
+        profiler::local().remove_task(std::coroutine_handle<task_promise<void>>::from_promise(*this).address());
+    }
+    std::source_location location_;
+#else
+    task_promise() noexcept = default;
+#endif
+
     inline task<void> get_return_object() noexcept;
     std::suspend_never initial_suspend() noexcept { return {}; }
     task_event_awaiter<void> await_transform(event ev);
@@ -92,6 +135,14 @@ struct task_promise<void> {
         }
     }
     inline task_final_awaiter<void> final_suspend() noexcept;
+    static void* operator new(size_t sz) {
+        ++local_driver_counters().live_frames;
+        return pool::local().allocate(sz);
+    }
+    static void operator delete(void* p, size_t sz) noexcept {
+        --local_driver_counters().live_frames;
+        pool::local().deallocate(p, sz);
+    }
 
     inline event_handle& make_interest();
     bool detached_ = false;
@@ -103,7 +154,11 @@ struct task_promise<void> {
 };
 
 inline task<void> task_promise<void>::get_return_object() noexcept {
-    return task<void>{std::coroutine_handle<task_promise<void>>::from_promise(*this)};
+    auto h = std::coroutine_handle<task_promise<void>>::from_promise(*this);
+#if COTAMER_PROFILE
+    profiler::local().add_task(h.address(), location_);
+#endif
+    return task<void>{h};
 }
 
 
@@ -129,7 +184,7 @@ struct task_awaiter {
         if (self_.promise().interest_) {
             self_.promise().interest_->trigger();
         }
-        return std::noop_coroutine();
+        return driver::current().transfer_from(awaiting.address());
     }
     // - Resume this coroutine, returning the `co_await` expression’s result
     T await_resume() {
@@ -154,13 +209,16 @@ struct task_final_awaiter {
         }
         // if another coroutine wants this task’s result, run them immediately
         if (promise.continuation_) {
-            return std::exchange(promise.continuation_, nullptr);
+            auto next = std::exchange(promise.continuation_, nullptr);
+            driver::current().pass_resumed(self.address(), next.address());
+            return next;
         }
         // destroy if detached and then return to event loop
+        void* addr = self.address();
         if (promise.detached_) {
             self.destroy();
         }
-        return std::noop_coroutine();
+        return driver::current().transfer_from(addr);
     }
     void await_resume() noexcept {
     }
@@ -197,10 +255,13 @@ inline event make_event(interest);
 // event_body
 //    The heap-allocated state behind an event. Managed by reference-counted
 //    event_handle smart pointers. Each event_body has a list of *listeners*
-//    (coroutines or quorum bodies) that are notified when the event triggers.
+//    (coroutines or quorum members) that are notified when the event triggers.
+//    The list is circular, and `listeners_` is its head.
 
 struct event_body {
-    event_body() = default;
+    event_body() noexcept {
+        listeners_.next = listeners_.prev = &listeners_;
+    }
     event_body(const event_body&) = delete;
     event_body(event_body&&) = delete;
     event_body& operator=(const event_body&) = delete;
@@ -214,68 +275,99 @@ struct event_body {
     // This event can be garbage collected: it has triggered, or it has no
     // listeners and no other references.
     bool empty() const noexcept {
-        return listeners_.empty_capacity()
-            || (listeners_.empty() && refcount_.load(std::memory_order_relaxed) == 1);
+        return triggered()
+            || (idle() && refcount_.load(std::memory_order_relaxed) == 1);
     }
 
     // This event has no listeners.
     bool idle() const noexcept {
-        return listeners_.empty();
+        return listeners_.next == &listeners_;
     }
 
     // The event has triggered.
     bool triggered() const noexcept {
-        return listeners_.empty_capacity();
-        // In its initial state, listeners_ has nonzero capacity; we set its
-        // capacity to 0 only in triggered().
-    }
-
-    void add_listener(uintptr_t listener) {
-        // A listener is either a `coroutine_handle<T>::address()` or the
-        // address of a `quorum_event_body`. Quorum bodies are distinguished by
-        // setting the `lf_quorum` bit, bit 1; this is safe because coroutines
-        // and quorum bodies are both aligned.
-        assert(listener && !triggered());
-        listeners_.push_back(listener);
-    }
-
-    bool remove_listener(uintptr_t listener) {
-        // Remove a listener (which might have been added multiple times).
-        bool found = false;
-        for (auto it = listeners_.begin(); it != listeners_.end(); ) {
-            if (*it == listener) {
-                *it = listeners_.back();
-                listeners_.pop_back();
-                found = true;
-            } else {
-                ++it;
-            }
+        return flags_ & f_triggered;
+    }
+
+    void add_listener(listener& l) {
+        assert(l.target && !l.linked() && !triggered());
+        l.prev = listeners_.prev;
+        l.next = &listeners_;
+        listeners_.prev->next = &l;
+        listeners_.prev = &l;
+    }
+
+    bool remove_listener(listener& l) {
+        // Returns false if `l` was not linked (for instance, because this
+        // event has triggered). The last listener takes `l`’s place, which
+        // is the order the listener array had before lists were intrusive;
+        // keeping it keeps simulations replaying identically.
+        if (!l.linked()) {
+            return false;
+        }
+        listener_link* last = listeners_.prev;
+        last->prev->next = &listeners_;
+        listeners_.prev = last->prev;
+        if (last != &l) {
+            last->next = l.next;
+            last->prev = l.prev;
+            l.prev->next = last;
+            l.next->prev = last;
         }
-        return found;
+        l.next = l.prev = nullptr;
+        return true;
     }
 
     inline void trigger();
 
+    // Event bodies (and quorum bodies) come from the thread’s pool.
+    static void* operator new(size_t sz) {
+        ++local_driver_counters().live_events;
+        return pool::local().allocate(sz);
+    }
+    static void operator delete(void* p, size_t sz) noexcept {
+        --local_driver_counters().live_events;
+        pool::local().deallocate(p, sz);
+    }
 
-    std::atomic<uint32_t> refcount_ = 1;
+
+    refcount_type refcount_ = 1;
     uint32_t flags_ = 0;
-    small_vector<uintptr_t, 3> listeners_;
+    uint32_t timer_index_ = timer_heap<event_handle>::npos;
+    listener_link listeners_;
+#if COTAMER_ATOMIC_REFCOUNT
+    // Handles may be dropped on other threads, but only the creating
+    // driver’s thread may touch its timer heap.
+    driver* owner_ = &driver::current();
+#endif
 };
 
 
 // quorum_event_body
-//    A subclass of event_body. Implements `any()` and `all()` by tracking
-//    member events, counting the number that have triggered, and triggering its
-//    own event (the event_body base type) once a quorum is reached.
+//    A subclass of event_body. Implements `any()`, `all()`, `at_least()`, and
+//    `countdown` by tracking member events, counting the number that have
+//    triggered, and triggering its own event (the event_body base type) once
+//    a quorum is reached.
+//
+//    Each member occupies a `quorum_member` slot, which is also the member
+//    event’s listener, so a triggering member finds its slot in O(1),
+//    however large the quorum. A triggered member’s slot is emptied but not
+//    removed. Slots must not move once listening, so the member array is
+//    reserved up front: every member comes from an argument.
 //
 //    The `f_interest` and `f_want_interest` flags implement an optimization
 //    that avoids allocating separate memory for `interest{}`.
 
+struct quorum_member : listener {
+    event_handle eh;
+};
+
 struct quorum_event_body : event_body {
     template<typename... Es>
     quorum_event_body(size_t quorum, Es&&... es)
         : quorum_(static_cast<uint32_t>(quorum)) {
         flags_ |= f_quorum;
+        members_.reserve(sizeof...(Es));
         (add_member(std::forward<Es>(es)), ...);
         if (triggered_ >= quorum_) {
             trigger();
@@ -283,13 +375,7 @@ struct quorum_event_body : event_body {
     }
 
     ~quorum_event_body() {
-        for (auto& mem : members_) {
-            mem->remove_listener(listener_id());
-        }
-    }
-
-    uintptr_t listener_id() const {
-        return reinterpret_cast<uintptr_t>(this) | lf_quorum;
+        remove_members();
     }
 
     void add_member(event_handle eh) {
@@ -297,11 +383,13 @@ struct quorum_event_body : event_body {
             ++triggered_;
             return;
         }
-        eh->add_listener(listener_id());
+        assert(members_.size() < members_.capacity());
         if (eh->flags_ & f_want_interest) {
             flags_ |= f_want_interest;
         }
-        members_.push_back(std::move(eh));
+        members_.push_back(quorum_member{{{}, reinterpret_cast<uintptr_t>(this) | lf_quorum}, std::move(eh)});
+        auto& m = members_.back();
+        m.eh->add_listener(m);
     }
 
     template <typename E>
@@ -313,42 +401,50 @@ struct quorum_event_body : event_body {
         flags_ = (flags_ + f_interest) | f_want_interest;
     }
 
-    // Called by a member event when it triggers.
-    void trigger_member(event_body* e) {
+    // Count `n` more members as triggered.
+    void count(uint32_t n) {
         if (triggered()) {
             return;
         }
-        for (auto it = members_.begin(); it != members_.end(); ) {
-            if (it->get() == e) {
-                ++triggered_;
-                *it = std::move(members_.back());
-                members_.pop_back();
-            } else {
-                ++it;
-            }
-        }
+        triggered_ += n;
         if (triggered_ >= quorum_) {
             trigger();
         }
     }
 
+    // Called by a member event when it triggers.
+    void trigger_member(quorum_member* m) {
+        if (triggered()) {
+            return;
+        }
+        m->eh = nullptr;
+        count(1);
+    }
+
+    // Stop listening to untriggered members and drop our references.
+    void remove_members() {
+        for (auto& m : members_) {
+            if (m.eh) {
+                m.eh->remove_listener(m);
+                m.eh = nullptr;
+            }
+        }
+    }
+
     inline void fix_want_interest(event_handle& ievent);
 
 
-    small_vector<event_handle, 3> members_;
+    small_vector<quorum_member, 3> members_;
     uint32_t triggered_ = 0;
     uint32_t quorum_;
 };
 
 
 inline void event_body::trigger() {
-    // Triggering a quorum erases its member list.
+    // Triggering a quorum empties its member slots. (The slots stay put:
+    // an event triggering a quorum may hold more than one of them.)
     if (flags_ & f_quorum) {
-        auto qbody = static_cast<quorum_event_body*>(this);
-        for (auto& mem : qbody->members_) {
-            mem->remove_listener(qbody->listener_id());
-        }
-        qbody->members_.clear();
+        static_cast<quorum_event_body*>(this)->remove_members();
     }
     // Activate listeners: schedule coroutines and inform quorum events.
     // But we can’t actually inform quorum events directly! It may be that
@@ -357,20 +453,24 @@ inline void event_body::trigger() {
     // satisfied, which would drop that reference and `delete this`.
     // So save a stack copy of the quorum listeners that will survive our
     // own deletion.
-    small_vector<quorum_event_body*, 2> qe;
-    for (auto listener : listeners_) {
-        if (listener & lf_quorum) {
-            qe.push_back(reinterpret_cast<quorum_event_body*>(listener & ~lf_quorum));
+    small_vector<quorum_member*, 2> qe;
+    for (listener_link* link = listeners_.next; link != &listeners_; ) {
+        auto l = static_cast<listener*>(link);
+        link = link->next;
+        l->next = l->prev = nullptr;
+        if (l->target & lf_quorum) {
+            qe.push_back(static_cast<quorum_member*>(l));
         } else {
-            driver::main->ready_.push_back(std::coroutine_handle<>::from_address(reinterpret_cast<void*>(listener)));
+            driver::current().make_ready(std::coroutine_handle<>::from_address(reinterpret_cast<void*>(l->target)));
         }
     }
     // Mark this event as triggered (not just empty).
-    listeners_.clear_capacity();
+    listeners_.next = listeners_.prev = &listeners_;
+    flags_ |= f_triggered;
     // Finally, inform our quorum listeners. During this loop `this` might
     // be freed.
-    for (auto listener : qe) {
-        listener->trigger_member(this);
+    for (auto m : qe) {
+        reinterpret_cast<quorum_event_body*>(m->target & ~lf_quorum)->trigger_member(m);
     }
 }
 
@@ -416,13 +516,33 @@ inline event_handle& event_handle::operator=(event_handle&& x) noexcept {
 }
 
 inline event_handle::~event_handle() {
-    if (eb_ && eb_->refcount_.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+    if (!eb_) {
+        return;
+    }
+    uint32_t old = eb_->refcount_.fetch_sub(1, std::memory_order_acq_rel);
+    if (old == 1) {
         // Check if this event_body is a quorum_event_body
         if (eb_->flags_ & f_quorum) {
             delete static_cast<quorum_event_body*>(eb_);
         } else {
             delete eb_;
         }
+    } else if (old == 2
+#if COTAMER_ATOMIC_REFCOUNT
+               && eb_->owner_ == &driver::current()
+#endif
+               && eb_->timer_index_ != timer_heap<event_handle>::npos
+               && eb_->idle()) {
+        // Only the timer heap still refers to this event, so it can never
+        // be observed: cancel the timer now. This drops the last reference.
+        // (On another thread, the timer is left to fire.)
+        driver::current().cancel_timer(eb_->timer_index_, eb_);
+    }
+}
+
+inline void event_handle::set_timer_index(unsigned i) noexcept {
+    if (eb_) {
+        eb_->timer_index_ = i;
     }
 }
 
@@ -444,37 +564,37 @@ inline bool event_handle::empty() const noexcept {
 template <typename T>
 struct task_event_awaiter {
     event_handle eh_;
-    uintptr_t coroutine_;
+    listener l_;        // linked into `eh_` while suspended
 
     ~task_event_awaiter() {
-        if (coroutine_ && !eh_->remove_listener(coroutine_)) {
+        if (l_.target && !eh_->remove_listener(l_)) {
             // Our containing coroutine is being destroyed while suspended, but
             // `eh_` has already triggered and scheduled our coroutine_handle on
             // the driver's ready queue. Avoid use-after-free by removing the
             // coroutine from the driver's queue.
-            auto coh = std::coroutine_handle<>::from_address(reinterpret_cast<void*>(coroutine_));
-            std::erase(driver::main->ready_, coh);
+            auto coh = std::coroutine_handle<>::from_address(reinterpret_cast<void*>(l_.target));
+            driver::current().ready_.erase(coh);
         }
     }
     bool await_ready() noexcept {
         return !eh_ || eh_->triggered();
     }
-    bool await_suspend(std::coroutine_handle<task_promise<T>> awaiting) noexcept {
+    std::coroutine_handle<> await_suspend(std::coroutine_handle<task_promise<T>> awaiting) noexcept {
         event_body* eb = eh_.get();
         // We’re about to suspend on `eb`. Optimization: Apply interest{} here,
         // just before suspending. That application might trigger `eb`.
         if (eb->flags_ & f_want_interest) {
             static_cast<quorum_event_body*>(eb)->fix_want_interest(awaiting.promise().make_interest());
             if (eb->triggered()) {
-                return false;
+                return awaiting;
             }
         }
-        coroutine_ = reinterpret_cast<uintptr_t>(awaiting.address());
-        eb->add_listener(coroutine_);
-        return true;
+        l_.target = reinterpret_cast<uintptr_t>(awaiting.address());
+        eb->add_listener(l_);
+        return driver::current().transfer_from(awaiting.address());
     }
     void await_resume() {
-        coroutine_ = 0;
+        l_.target = 0;
         // This code helps recover memory when clearing a driver (for instance,
         // if a test exits early). The clearing process triggers all
         // outstanding events and unblocks their waiting coroutines, but those
@@ -490,11 +610,11 @@ struct task_event_awaiter {
 
 template <typename T>
 inline task_event_awaiter<T> task_promise<T>::await_transform(event ev) {
-    return task_event_awaiter<T>{std::move(ev).handle(), 0};
+    return task_event_awaiter<T>{std::move(ev).handle(), {}};
 }
 
 inline task_event_awaiter<void> task_promise<void>::await_transform(event ev) {
-    return task_event_awaiter<void>{std::move(ev).handle(), 0};
+    return task_event_awaiter<void>{std::move(ev).handle(), {}};
 }
 
 
@@ -519,11 +639,11 @@ inline event_handle& task_promise<void>::make_interest() {
 
 template <typename T>
 inline task_event_awaiter<T> task_promise<T>::await_transform(interest) {
-    return task_event_awaiter<T>{make_interest(), 0};
+    return task_event_awaiter<T>{make_interest(), {}};
 }
 
 inline task_event_awaiter<void> task_promise<void>::await_transform(interest) {
-    return task_event_awaiter<void>{make_interest(), 0};
+    return task_event_awaiter<void>{make_interest(), {}};
 }
 
 // make_event(interest)
@@ -580,9 +700,9 @@ inline void quorum_event_body::fix_want_interest(event_handle& ievent) {
     // and/or removes the last reference to `this`, deleting `this`. So make a
     // stack copy first.
     small_vector<event_handle, 3> wi_members;
-    for (auto& mem : members_) {
-        if (mem->flags_ & f_want_interest) {
-            wi_members.push_back(mem);
+    for (auto& m : members_) {
+        if (m.eh && (m.eh->flags_ & f_want_interest)) {
+            wi_members.push_back(m.eh);
         }
     }
     for (auto& mem : wi_members) {
@@ -590,6 +710,339 @@ inline void quorum_event_body::fix_want_interest(event_handle& ievent) {
     }
 }
 
+
+// waiter
+//    A listener for a coroutine suspended in a FIFO wait list, such as a
+//    notifier’s or a channel’s. `wake()` unlinks the waiter and schedules its
+//    coroutine. Destroying a waiter (because its coroutine is destroyed while
+//    suspended) unlinks it or, if it was already woken, unschedules it, as in
+//    `~task_event_awaiter`.
+
+struct waiter : listener {
+    waiter() = default;
+    waiter(const waiter&) = default;    // only copied before suspending
+    ~waiter() {
+        if (target && linked()) {
+            unlink();
+        } else if (target) {
+            auto coh = std::coroutine_handle<>::from_address(reinterpret_cast<void*>(target));
+            driver::current().ready_.erase(coh);
+        }
+    }
+
+    // Append to `list` and leave `awaiting` for the next ready coroutine.
+    std::coroutine_handle<> suspend(listener_link& list, std::coroutine_handle<> awaiting) noexcept {
+        target = reinterpret_cast<uintptr_t>(awaiting.address());
+        prev = list.prev;
+        next = &list;
+        list.prev->next = this;
+        list.prev = this;
+        return driver::current().transfer_from(awaiting.address());
+    }
+    void resume() {
+        target = 0;
+        if (driver::clearing) {
+            throw clearing_error{};
+        }
+    }
+
+    void unlink() noexcept {
+        prev->next = next;
+        next->prev = prev;
+        next = prev = nullptr;
+    }
+    void wake() {
+        unlink();
+        driver::current().make_ready(std::coroutine_handle<>::from_address(reinterpret_cast<void*>(target)));
+    }
+
+    static void init(listener_link& list) noexcept {
+        list.next = list.prev = &list;
+    }
+    static waiter* first(listener_link& list) noexcept {
+        return list.next == &list ? nullptr : static_cast<waiter*>(list.next);
+    }
+};
+
+
+// notifier_awaiter
+//    Awaiter for `co_await notifier.wait()`.
+
+struct notifier_awaiter : waiter {
+    listener_link* waiters_;
+
+    explicit notifier_awaiter(listener_link* waiters) noexcept
+        : waiters_(waiters) {
+    }
+
+    bool await_ready() noexcept {
+        return false;
+    }
+    std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting) noexcept {
+        return suspend(*waiters_, awaiting);
+    }
+    void await_resume() {
+        resume();
+    }
+};
+
+
+// channel_push_awaiter<T>, channel_pop_awaiter<T>, channel_pop_all_awaiter<T>
+//    Awaiters for `channel<T>`. A waiting pusher holds its value until a
+//    popper moves it out; a waiting popper receives a value from a pusher in
+//    `value_`. So a value handed to a waiting task cannot be taken by another
+//    task before the waiting task runs.
+
+template <typename T>
+struct channel_push_awaiter : waiter {
+    channel<T>* ch_;
+    T value_;
+
+    bool await_ready() {
+        return ch_->give(value_);
+    }
+    std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting) noexcept {
+        return suspend(ch_->pushers_, awaiting);
+    }
+    void await_resume() {
+        resume();
+    }
+};
+
+template <typename T>
+struct channel_popper : waiter {
+    channel<T>* ch_;
+    std::optional<T> value_;
+
+    explicit channel_popper(channel<T>* ch) noexcept
+        : ch_(ch) {
+    }
+    std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting) noexcept {
+        return suspend(ch_->poppers_, awaiting);
+    }
+};
+
+template <typename T>
+struct channel_pop_awaiter : channel_popper<T> {
+    using channel_popper<T>::channel_popper;
+
+    bool await_ready() {
+        return this->ch_->take(this->value_);
+    }
+    T await_resume() {
+        this->resume();
+        assert(this->value_);   // not woken by `~channel`
+        return std::move(*this->value_);
+    }
+};
+
+template <typename T>
+struct channel_pop_all_awaiter : channel_popper<T> {
+    std::vector<T>* out_;
+
+    channel_pop_all_awaiter(channel<T>* ch, std::vector<T>* out) noexcept
+        : channel_popper<T>(ch), out_(out) {
+    }
+
+    bool await_ready() {
+        return this->ch_->take(this->value_);
+    }
+    size_t await_resume() {
+        this->resume();
+        size_t n = out_->size();
+        if (this->value_) {
+            out_->push_back(std::move(*this->value_));
+            while (this->ch_->take(this->value_)) {
+                out_->push_back(std::move(*this->value_));
+            }
+        }
+        return out_->size() - n;
+    }
+};
+
+
+#if __linux__
+// io_awaiter
+//    Awaiter for `cotamer::io` operations, which run on the real-time
+//    driver’s io_uring (see `detail/uring.hh`). The suspending and
+//    completion paths live in `detail/uring.cc`.
+
+enum class io_op : uint8_t { read, write, recv, send, accept, connect };
+
+struct io_awaiter {
+    enum state_type : uint8_t { s_idle, s_inflight, s_abandoned, s_done };
+
+    io_op op_;
+    state_type state_ = s_idle;
+    int fd_;
+    int result_ = 0;
+    uint32_t len_;
+    uint32_t flags_;
+    uint64_t addr_;
+    uint64_t off_;                  // file offset, or address length
+    std::coroutine_handle<> handle_;
+
+    io_awaiter(io_op op, int fd, const void* addr, size_t len,
+               uint32_t flags, uint64_t off) noexcept
+        : op_(op), fd_(fd),
+          len_(uint32_t(std::min(len, size_t(0x7FFFF000)))),  // Linux’s max I/O
+          flags_(flags), addr_(reinterpret_cast<uintptr_t>(addr)), off_(off) {
+    }
+    io_awaiter(const io_awaiter&) = default;    // only copied before suspending
+    ~io_awaiter() {
+        if (state_ != s_idle) [[unlikely]] {
+            abandon();
+        }
+    }
+
+    bool await_ready() noexcept {
+        return false;
+    }
+    std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting);
+    int await_resume() {
+        state_ = s_idle;
+        if (driver::clearing) {
+            throw clearing_error{};
+        }
+        return result_;
+    }
+
+    void complete(int res);
+    void abandon();
+};
+#endif
+
+}
+
+
+// notifier methods
+
+inline notifier::notifier() noexcept {
+    detail::waiter::init(waiters_);
+}
+
+inline notifier::~notifier() {
+    notify_all();
+}
+
+inline detail::notifier_awaiter notifier::wait() noexcept {
+    return detail::notifier_awaiter(&waiters_);
+}
+
+inline bool notifier::notify_one() {
+    auto w = detail::waiter::first(waiters_);
+    if (!w) {
+        return false;
+    }
+    w->wake();
+    return true;
+}
+
+inline void notifier::notify_all() {
+    while (notify_one()) {
+    }
+}
+
+inline bool notifier::idle() const noexcept {
+    return waiters_.next == &waiters_;
+}
+
+
+// channel methods
+
+template <typename T>
+inline channel<T>::channel(size_t capacity)
+    : capacity_(capacity) {
+    detail::waiter::init(pushers_);
+    detail::waiter::init(poppers_);
+}
+
+template <typename T>
+inline channel<T>::~channel() {
+    while (auto w = detail::waiter::first(pushers_)) {
+        w->wake();
+    }
+    while (auto w = detail::waiter::first(poppers_)) {
+        w->wake();
+    }
+}
+
+template <typename T>
+inline auto channel<T>::push(T x) -> detail::channel_push_awaiter<T> {
+    return detail::channel_push_awaiter<T>{{}, this, std::move(x)};
+}
+
+template <typename T>
+inline auto channel<T>::pop() noexcept -> detail::channel_pop_awaiter<T> {
+    return detail::channel_pop_awaiter<T>(this);
+}
+
+template <typename T>
+inline auto channel<T>::pop_all(std::vector<T>& out) noexcept -> detail::channel_pop_all_awaiter<T> {
+    return detail::channel_pop_all_awaiter<T>(this, &out);
+}
+
+template <typename T>
+inline bool channel<T>::try_push(T&& x) {
+    return give(x);
+}
+
+template <typename T>
+inline bool channel<T>::try_push(const T& x) {
+    T copy(x);
+    return give(copy);
+}
+
+template <typename T>
+inline std::optional<T> channel<T>::try_pop() {
+    std::optional<T> v;
+    take(v);
+    return v;
+}
+
+// Hand `x` to the first waiting popper, or else enqueue it if there is room.
+// Moves from `x` only on success.
+template <typename T>
+bool channel<T>::give(T& x) {
+    if (auto w = detail::waiter::first(poppers_)) {
+        auto p = static_cast<detail::channel_popper<T>*>(w);
+        p->value_.emplace(std::move(x));
+        p->wake();
+        return true;
+    } else if (q_.size() < capacity_) {
+        q_.push_back(std::move(x));
+        return true;
+    }
+    return false;
+}
+
+// Move the next value into `v`, if there is one, then refill the queue
+// from waiting pushers.
+template <typename T>
+bool channel<T>::take(std::optional<T>& v) {
+    if (!q_.empty()) {
+        v.emplace(std::move(q_.front()));
+        q_.pop_front();
+    } else if (auto w = detail::waiter::first(pushers_)) {
+        // only when `capacity() == 0`
+        auto p = static_cast<detail::channel_push_awaiter<T>*>(w);
+        v.emplace(std::move(p->value_));
+        p->wake();
+        return true;
+    } else {
+        v.reset();
+        return false;
+    }
+    while (q_.size() < capacity_) {
+        auto w = detail::waiter::first(pushers_);
+        if (!w) {
+            break;
+        }
+        auto p = static_cast<detail::channel_push_awaiter<T>*>(w);
+        q_.push_back(std::move(p->value_));
+        p->wake();
+    }
+    return true;
 }
 
 
@@ -713,6 +1166,26 @@ inline detail::task_awaiter<T> task<T>::operator co_await() const noexcept {
 
 // driver methods
 
+namespace detail {
+// - Only `timer_heap` reports timer positions; the wheel culls dead timers
+//   lazily instead. A timer’s position is only meaningful in its own
+//   driver’s heap, so it must be cancelled on that driver’s thread.
+template <typename T>
+inline void erase_timer(timer_heap<T>& q, unsigned i, const event_body* eb) {
+    assert(i < q.size() && q.at(i).get() == eb);
+    (void) eb;
+    q.erase(i);
+}
+
+template <typename T>
+inline void erase_timer(timer_wheel<T>&, unsigned, const event_body*) {
+}
+}
+
+inline void driver::cancel_timer(unsigned i, const detail::event_body* eb) {
+    detail::erase_timer(timed_, i, eb);
+}
+
 inline clock::time_point driver::now() {
     return now_;
 }
@@ -733,6 +1206,10 @@ inline event driver::asap() {
 
 inline void driver::at(clock::time_point t, event e) {
     timed_.emplace(t, std::move(e).handle());
+    auto& c = detail::local_driver_counters();
+    if (timed_.size() > c.timer_peak) {
+        c.timer_peak = timed_.size();
+    }
 }
 
 inline event driver::at(clock::time_point t) {
@@ -753,26 +1230,100 @@ inline event driver::after(clock::duration d) {
 }
 
 
+// driver::current()
+//    Return this thread’s driver. `current_` caches `main.get()` in a
+//    constant-initialized thread-local, which is cheaper to reach than
+//    `main` itself.
+
+inline driver& driver::current() {
+    driver* d = current_;
+    if (!d) [[unlikely]] {
+        d = current_ = main.get();
+    }
+    return *d;
+}
+
+
+// driver::resume(ch), driver::transfer_from(self), driver::pass_resumed(from, to)
+//    Direct transfer support. The loop resumes ready coroutines with
+//    `resume`. A coroutine about to suspend calls `transfer_from` for the
+//    handle to switch to: if it was resumed by the loop and another
+//    coroutine is ready, that coroutine, else `noop_coroutine()`. A
+//    completing coroutine that transfers to its continuation calls
+//    `pass_resumed`, since the continuation now returns to the loop.
+
+inline void driver::make_ready(std::coroutine_handle<> ch) {
+    ready_.push_back(ch);
+    auto& c = detail::local_driver_counters();
+    if (ready_.size() > c.ready_peak) {
+        c.ready_peak = ready_.size();
+    }
+}
+
+inline void driver::resume(std::coroutine_handle<> ch) {
+    ++detail::local_driver_counters().resumptions;
+    if constexpr (profiling) {
+        // look up the tag first: `ch` might complete and be destroyed
+        auto& prof = detail::profiler::local();
+        unsigned tag = prof.tag_of(ch.address());
+        auto t0 = std::chrono::steady_clock::now();
+        ch();
+        prof.record(tag, std::chrono::steady_clock::now() - t0);
+    } else if constexpr (direct_transfer) {
+        resumed_ = ch.address();
+        transfers_ = 0;
+        ch();
+        resumed_ = nullptr;
+    } else {
+        ch();
+    }
+}
+
+inline std::coroutine_handle<> driver::transfer_from(void* self) {
+    if constexpr (direct_transfer) {
+        if (self == resumed_ && !ready_.empty() && transfers_ < max_transfers) {
+            // exactly what the loop would do once `self` suspends
+            auto ch = ready_.front();
+            ready_.pop_front();
+            now_ += clock::duration{1};
+            resumed_ = ch.address();
+            ++transfers_;
+            ++detail::local_driver_counters().resumptions;
+            return ch;
+        }
+    }
+    return std::noop_coroutine();
+}
+
+inline void driver::pass_resumed(void* from, void* to) {
+    if constexpr (direct_transfer) {
+        if (from == resumed_) {
+            resumed_ = to;
+        }
+    }
+}
+
+
 // time functions
 
 inline clock::time_point now() {
-    return driver::main->now();
+    return driver::current().now();
 }
 
 inline void step_time() {
-    driver::main->step_time();
+    driver::current().step_time();
 }
 
 inline event asap() {
-    return driver::main->asap();
+    return driver::current().asap();
 }
 
 inline event at(clock::time_point t) {
-    return driver::main->at(t);
+    return driver::current().at(t);
 }
 
 inline event after(clock::duration d) {
-    return driver::main->after(d);
+    return driver::current().after(d);
 }
 
 
@@ -818,6 +1369,65 @@ inline event all() {
 }
 
 
+// any(range), all(range), at_least(k, range)
+//    Range forms always create a quorum_event_body, with the same results
+//    as the variadic forms for an empty range.
+
+namespace detail {
+template <typename R>
+inline event make_range_quorum(size_t quorum, R&& r) {
+    auto q = new quorum_event_body(quorum);
+    if (!q->triggered()) {
+        q->members_.reserve(std::ranges::size(r));
+        for (const event& e : r) {
+            q->add_member(e.handle());
+        }
+        q->count(0);
+    }
+    return event_handle(q);
+}
+}
+
+template <event_range R>
+inline event any(R&& r) {
+    if (std::ranges::empty(r)) {
+        return event(nullptr);
+    }
+    return detail::make_range_quorum(1, std::forward<R>(r));
+}
+
+template <event_range R>
+inline event all(R&& r) {
+    return detail::make_range_quorum(std::ranges::size(r), std::forward<R>(r));
+}
+
+template <event_range R>
+inline event at_least(size_t k, R&& r) {
+    return detail::make_range_quorum(k, std::forward<R>(r));
+}
+
+
+// countdown methods
+
+inline countdown::countdown(size_t n)
+    : ep_(new detail::quorum_event_body(n)) {
+}
+
+inline void countdown::count_down(size_t k) {
+    auto q = static_cast<detail::quorum_event_body*>(ep_.get());
+    q->count(static_cast<uint32_t>(std::min<size_t>(k, remaining())));
+}
+
+inline size_t countdown::remaining() const noexcept {
+    auto q = static_cast<const detail::quorum_event_body*>(ep_.get());
+    return q->triggered() ? 0 : q->quorum_ - q->triggered_;
+}
+
+inline event countdown::completion() const {
+    return event(ep_);
+}
+
+
 // attempt(t, e...)
 //    Runs a `task<T>` (the first argument) with cancellation (the other
 //    arguments). Returns `task<std::optional<T>>`, which is `nullopt` if the
@@ -864,15 +1474,76 @@ task<std::optional<std::monostate>> attempt(task<void> t, Es&&... es) {
 // driver functions
 
 inline void loop() {
-    driver::main->loop();
+    driver::current().loop();
 }
 
 inline void clear() {
-    driver::main->clear();
+    driver::current().clear();
+}
+
+inline event readable(int fd) {
+    return driver::current().readable(fd);
+}
+
+inline event writable(int fd) {
+    return driver::current().writable(fd);
+}
+
+inline void forget_fd(int fd) {
+    driver::current().forget_fd(fd);
+}
+
+#if __linux__
+namespace io {
+inline detail::io_awaiter read(int fd, void* buf, size_t n, uint64_t offset) {
+    return detail::io_awaiter(detail::io_op::read, fd, buf, n, 0, offset);
+}
+
+inline detail::io_awaiter write(int fd, const void* buf, size_t n, uint64_t offset) {
+    return detail::io_awaiter(detail::io_op::write, fd, buf, n, 0, offset);
+}
+
+inline detail::io_awaiter recv(int fd, void* buf, size_t n, int flags) {
+    return detail::io_awaiter(detail::io_op::recv, fd, buf, n, flags, 0);
+}
+
+inline detail::io_awaiter send(int fd, const void* buf, size_t n, int flags) {
+    return detail::io_awaiter(detail::io_op::send, fd, buf, n, flags, 0);
+}
+
+inline detail::io_awaiter accept(int fd, sockaddr* addr, socklen_t* addrlen, int flags) {
+    return detail::io_awaiter(detail::io_op::accept, fd, addr, 0, flags,
+                              reinterpret_cast<uintptr_t>(addrlen));
+}
+
+inline detail::io_awaiter connect(int fd, const sockaddr* addr, socklen_t addrlen) {
+    return detail::io_awaiter(detail::io_op::connect, fd, addr, 0, 0, addrlen);
+}
+}
+#endif
+
+inline const detail::pool_counters& pool_stats() {
+    return detail::pool::local().counters();
+}
+
+inline driver_counters driver_stats() {
+    return driver::current().stats();
+}
+
+inline driver_mode driver::mode() const {
+    return poller_ ? driver_mode::real_time : driver_mode::simulated;
 }
 
 inline size_t driver::timer_size() const {
     return timed_.size();
 }
 
+inline const timer_counters& driver::timer_stats() const {
+    return timed_.stats();
+}
+
+inline size_t driver::ready_size() const {
+    return ready_.size();
+}
+
 }
@@ -15,6 +15,14 @@ template <typename T> struct task_awaiter;
 template <typename T> struct task_event_awaiter;
 template <typename T> struct task_final_awaiter;
 struct interest_event_awaiter;
+struct waiter;
+struct notifier_awaiter;
+template <typename T> struct channel_push_awaiter;
+template <typename T> struct channel_popper;
+template <typename T> struct channel_pop_awaiter;
+template <typename T> struct channel_pop_all_awaiter;
+class poller;
+struct io_awaiter;
 
 class event_handle {
 public:
@@ -35,6 +43,9 @@ public:
     event_body& operator*() const { return *eb_; }
     event_body* operator->() const { return eb_; }
 
+    // Timer queue hook: record this event’s position in the timer heap.
+    inline void set_timer_index(unsigned i) noexcept;
+
 private:
     event_body* eb_ = nullptr;
 };
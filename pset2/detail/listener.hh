@@ -0,0 +1,33 @@
+#pragma once
+#include <cstdint>
+
+// listener.hh
+//    Intrusive wait-list nodes. Each waiter embeds its own node: a
+//    `task_event_awaiter` or `notifier_awaiter` (which lives in its suspended
+//    coroutine’s frame), or a `quorum_member`. So adding and removing a
+//    waiter is O(1) and never allocates. A node must not move while it is
+//    linked. Lists are circular; the owner (an event body or a `notifier`)
+//    holds the head, a bare `listener_link`.
+//
+//    `target` is either a `coroutine_handle<T>::address()`, for an awaiter,
+//    or the address of the member’s `quorum_event_body` with bit 1 set, for
+//    a quorum member.
+
+namespace cotamer {
+namespace detail {
+
+struct listener_link {
+    listener_link* next = nullptr;      // null iff not linked
+    listener_link* prev = nullptr;
+};
+
+struct listener : listener_link {
+    uintptr_t target = 0;
+
+    bool linked() const noexcept {
+        return next != nullptr;
+    }
+};
+
+}
+}
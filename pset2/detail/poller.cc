@@ -0,0 +1,262 @@
+#include "detail/poller.hh"
+#include "cotamer.hh"
+#include <algorithm>
+#include <cerrno>
+#include <system_error>
+#if __linux__
+#include "detail/uring.hh"
+#include <sys/epoll.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+#else
+#include <thread>
+#endif
+
+namespace cotamer {
+namespace detail {
+
+namespace {
+[[noreturn]] void throw_errno(const char* what) {
+    throw std::system_error(errno, std::generic_category(), what);
+}
+
+#if __linux__
+// epoll events that wake readers [0] and writers [1]
+constexpr uint32_t wake_mask[2] = {
+    EPOLLIN | EPOLLRDHUP | EPOLLHUP | EPOLLERR, EPOLLOUT | EPOLLHUP | EPOLLERR
+};
+constexpr uint32_t want_mask[2] = {EPOLLIN | EPOLLRDHUP, EPOLLOUT};
+#endif
+}
+
+poller::poller()
+    : epoch_(clock::now()), steady_epoch_(std::chrono::steady_clock::now()) {
+#if __linux__
+    epfd_ = epoll_create1(EPOLL_CLOEXEC);
+    if (epfd_ < 0) {
+        throw_errno("epoll_create1");
+    }
+    timerfd_ = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    epoll_event ev{};
+    ev.events = EPOLLIN;
+    ev.data.fd = timerfd_;
+    if (timerfd_ < 0 || epoll_ctl(epfd_, EPOLL_CTL_ADD, timerfd_, &ev) != 0) {
+        int err = errno;
+        if (timerfd_ >= 0) {
+            ::close(timerfd_);
+        }
+        ::close(epfd_);
+        throw std::system_error(err, std::generic_category(), "timerfd");
+    }
+#endif
+}
+
+poller::~poller() {
+    clear();
+#if __linux__
+    uring_.reset();
+    ::close(timerfd_);
+    ::close(epfd_);
+#endif
+}
+
+
+event_handle poller::watch(int fd, bool write) {
+#if __linux__
+    if (fd < 0 || fd == epfd_ || fd == timerfd_) {
+        throw std::system_error(EBADF, std::generic_category(), "cotamer::poller::watch");
+    }
+    if (size_t(fd) >= watches_.size()) {
+        watches_.resize(fd + 1);
+    }
+    auto& w = watches_[fd];
+    auto& eh = w.ev[write];
+    if (!eh.empty()) {
+        return eh;
+    }
+    event_handle e(new event_body);
+    uint32_t want = w.registered | want_mask[write];
+    if (want != w.registered) {
+        epoll_event ev{};
+        ev.events = want;
+        ev.data.fd = fd;
+        int op = w.registered ? EPOLL_CTL_MOD : EPOLL_CTL_ADD;
+        int r = epoll_ctl(epfd_, op, fd, &ev);
+        if (r != 0 && (errno == ENOENT || errno == EEXIST)) {
+            // `fd` was closed and reused, or registered behind our back
+            op = op == EPOLL_CTL_MOD ? EPOLL_CTL_ADD : EPOLL_CTL_MOD;
+            r = epoll_ctl(epfd_, op, fd, &ev);
+        }
+        if (r != 0 && errno == EPERM) {
+            // regular files and directories are always ready
+            e->trigger();
+            return e;
+        } else if (r != 0) {
+            throw_errno("epoll_ctl");
+        }
+        w.registered = want;
+    }
+    eh = e;
+    if (!w.active) {
+        w.active = true;
+        active_.push_back(fd);
+    }
+    return e;
+#else
+    (void) fd, (void) write;
+    throw std::system_error(std::make_error_code(std::errc::function_not_supported),
+                            "cotamer::poller::watch");
+#endif
+}
+
+void poller::forget(int fd) {
+    if (fd < 0 || size_t(fd) >= watches_.size()) {
+        return;
+    }
+    auto& w = watches_[fd];
+#if __linux__
+    if (w.registered) {
+        // `fd` might already be closed
+        epoll_ctl(epfd_, EPOLL_CTL_DEL, fd, nullptr);
+        w.registered = 0;
+    }
+#endif
+    event_handle r = std::move(w.ev[0]), x = std::move(w.ev[1]);
+    w.ev[0] = w.ev[1] = nullptr;
+    if (r) {
+        r->trigger();
+    }
+    if (x) {
+        x->trigger();
+    }
+}
+
+void poller::clear() {
+#if __linux__
+    if (uring_) {
+        uring_->cancel_all();
+    }
+#endif
+    for (int fd : active_) {
+        watches_[fd].active = false;
+        forget(fd);
+    }
+    active_.clear();
+}
+
+bool poller::live() {
+#if __linux__
+    if (uring_ && uring_->inflight() != 0) {
+        return true;
+    }
+#endif
+    // Drop unobservable watches until a live one turns up. Their epoll
+    // registrations are removed lazily, by `wait`.
+    while (!active_.empty()) {
+        auto& w = watches_[active_.back()];
+        if (!w.ev[0].empty() || !w.ev[1].empty()) {
+            return true;
+        }
+        w.ev[0] = w.ev[1] = nullptr;
+        w.active = false;
+        active_.pop_back();
+    }
+    return false;
+}
+
+#if __linux__
+uring& poller::ring() {
+    if (!uring_) {
+        auto r = std::make_unique<uring>(256);
+        epoll_event ev{};
+        ev.events = EPOLLIN;
+        ev.data.fd = r->fd();
+        if (epoll_ctl(epfd_, EPOLL_CTL_ADD, r->fd(), &ev) != 0) {
+            throw_errno("epoll_ctl");
+        }
+        uring_ = std::move(r);
+    }
+    return *uring_;
+}
+#endif
+
+void poller::flush() {
+#if __linux__
+    if (uring_) {
+        uring_->flush();
+    }
+#endif
+}
+
+
+void poller::wait(clock::time_point deadline) {
+#if __linux__
+    if (deadline != armed_) {
+        itimerspec its{};           // all zero: disarm
+        if (deadline != clock::time_point::max()) {
+            auto t = steady_epoch_ + (deadline - epoch_);
+            auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(t.time_since_epoch()).count();
+            ns = std::max(ns, decltype(ns)(1));
+            its.it_value.tv_sec = ns / 1000000000;
+            its.it_value.tv_nsec = ns % 1000000000;
+        }
+        if (timerfd_settime(timerfd_, TFD_TIMER_ABSTIME, &its, nullptr) != 0) {
+            throw_errno("timerfd_settime");
+        }
+        armed_ = deadline;
+    }
+
+    epoll_event evs[64];
+    int n = epoll_wait(epfd_, evs, 64, -1);
+    if (n < 0 && errno != EINTR) {
+        throw_errno("epoll_wait");
+    }
+    for (int i = 0; i < n; ++i) {
+        int fd = evs[i].data.fd;
+        if (fd == timerfd_) {
+            uint64_t expirations;
+            (void) ::read(timerfd_, &expirations, sizeof(expirations));
+            armed_ = clock::time_point::max();
+            continue;
+        } else if (uring_ && fd == uring_->fd()) {
+            uring_->flush();
+            continue;
+        }
+        auto& w = watches_[fd];
+        event_handle fired[2];
+        uint32_t want = 0;
+        for (int dir = 0; dir != 2; ++dir) {
+            if (w.ev[dir].empty()) {
+                w.ev[dir] = nullptr;
+            } else if (evs[i].events & wake_mask[dir]) {
+                fired[dir] = std::move(w.ev[dir]);
+                w.ev[dir] = nullptr;
+                want |= want_mask[dir];
+            } else {
+                want |= want_mask[dir];
+            }
+        }
+        // Keep registrations for directions that just fired: their waiters
+        // will likely be back. Drop the rest.
+        if (want != w.registered) {
+            epoll_event ev{};
+            ev.events = want;
+            ev.data.fd = fd;
+            epoll_ctl(epfd_, want ? EPOLL_CTL_MOD : EPOLL_CTL_DEL, fd, &ev);
+            w.registered = want;
+        }
+        for (auto& e : fired) {
+            if (e) {
+                e->trigger();
+            }
+        }
+    }
+#else
+    if (deadline != clock::time_point::max()) {
+        std::this_thread::sleep_until(steady_epoch_ + (deadline - epoch_));
+    }
+#endif
+}
+
+}
+}
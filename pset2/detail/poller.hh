@@ -0,0 +1,93 @@
+#pragma once
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include "detail/event_handle.hh"
+
+// poller.hh
+//    The real-time driver’s clock and sleeper (see `driver_mode`). On Linux
+//    it owns an epoll instance and a timerfd: `wait(deadline)` arms the
+//    timerfd for `deadline`, if that changed, and sleeps in `epoll_wait`
+//    until the deadline passes or a watched file descriptor becomes ready.
+//    Elsewhere it sleeps with `std::this_thread::sleep_until` and cannot
+//    watch file descriptors.
+//
+//    Each watched fd has up to two events, for reading and writing.
+//    Registrations are level-triggered and dropped lazily: after an event
+//    fires, the fd stays registered until epoll reports it again with nobody
+//    waiting. So a task that alternates `read` and `co_await readable(fd)`
+//    makes no `epoll_ctl` calls in the steady state.
+//
+//    The poller also owns the driver’s io_uring (`detail/uring.hh`), created
+//    when the first `io::` operation starts. Its fd is watched by epoll, so
+//    I/O completions wake `wait`.
+
+namespace cotamer {
+namespace detail {
+class uring;
+
+class poller {
+public:
+    using clock = std::chrono::system_clock;
+
+    poller();
+    ~poller();
+    poller(const poller&) = delete;
+    poller(poller&&) = delete;
+    poller& operator=(const poller&) = delete;
+    poller& operator=(poller&&) = delete;
+
+    // Real time on the driver’s clock: `clock::now()` at construction, then
+    // advanced by the steady clock.
+    clock::time_point now() const noexcept {
+        return epoch_ + std::chrono::duration_cast<clock::duration>(
+            std::chrono::steady_clock::now() - steady_epoch_);
+    }
+
+    // Return the event for `fd` becoming readable (`write == false`) or
+    // writable.
+    event_handle watch(int fd, bool write);
+    // Trigger and drop `fd`’s events; call before closing `fd`.
+    void forget(int fd);
+    // Trigger and drop all events.
+    void clear();
+
+    // Return true if some task can still observe a watched fd event, or an
+    // I/O operation is in flight.
+    bool live();
+
+#if __linux__
+    // Return the io_uring, creating it if necessary.
+    uring& ring();
+#endif
+    // Submit queued I/O operations and harvest completed ones.
+    void flush();
+
+    // Sleep until `deadline` or until a watched fd is ready, then trigger
+    // the events of ready fds. `deadline` may be `time_point::max()`.
+    void wait(clock::time_point deadline);
+
+private:
+    struct watch_type {
+        event_handle ev[2];             // [0] readable, [1] writable
+        uint32_t registered = 0;        // epoll event mask, 0 if none
+        bool active = false;            // listed in `active_`
+    };
+
+    clock::time_point epoch_;
+    std::chrono::steady_clock::time_point steady_epoch_;
+    std::vector<watch_type> watches_;   // indexed by fd
+    std::vector<int> active_;           // fds that might have live events
+    int epfd_ = -1;
+    int timerfd_ = -1;
+    clock::time_point armed_ = clock::time_point::max();
+#if __linux__
+    std::unique_ptr<uring> uring_;
+#endif
+
+    void update(int fd);
+};
+
+}
+}
@@ -0,0 +1,216 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <new>
+#include <type_traits>
+#include <vector>
+
+// pool.hh
+//    Size-class freelists for small objects that Cotamer allocates and frees
+//    at a high rate: event bodies and task coroutine frames. Sizes are
+//    rounded up to a multiple of `granule`; each size class has its own
+//    freelist, refilled from `slab_size` slabs. Larger objects go straight
+//    to `operator new`.
+//
+//    Each thread has its own pool, so allocation takes no locks. An object
+//    freed on another thread joins that thread’s freelist. Slabs are never
+//    returned to the system, but they stay reachable from a global list,
+//    and when a thread exits its freelists move to a global orphanage that
+//    later refills draw from. The pool itself is trivially destructible, so
+//    objects freed later in thread or program exit still have somewhere to
+//    go: after the exit hook runs, they join the orphanage directly.
+
+namespace cotamer {
+namespace detail {
+
+struct pool_counters {
+    uint64_t allocations = 0;   // objects allocated from freelists
+    uint64_t frees = 0;         // objects returned to freelists
+    uint64_t slabs = 0;         // slabs carved into freelists
+    uint64_t large = 0;         // allocations too big for any size class
+};
+
+class pool {
+public:
+    static constexpr size_t granule = 16;
+    static constexpr size_t nclasses = 64;      // up to 1024 bytes
+    static constexpr size_t slab_size = 16384;
+
+    inline void* allocate(size_t sz);
+    inline void deallocate(void* p, size_t sz) noexcept;
+
+    const pool_counters& counters() const {
+        return counters_;
+    }
+
+    static inline pool& local() noexcept;
+
+private:
+    struct free_object {
+        free_object* next;
+    };
+
+    // freelists and slabs shared by all threads
+    struct orphanage {
+        std::mutex mutex;
+        free_object* free[nclasses] = {};
+        std::vector<void*> slabs;
+    };
+
+    enum state_type : uint8_t { s_new, s_live, s_exited };
+
+    free_object* free_[nclasses] = {};
+    pool_counters counters_;
+    state_type state_ = s_new;
+
+    static size_t size_class(size_t sz) {
+        return sz ? (sz - 1) / granule : 0;
+    }
+    static inline orphanage& orphans();
+    inline void start();
+    inline void orphan() noexcept;
+    inline void refill(size_t c);
+    inline free_object* carve(orphanage& o, size_t c);
+    inline void* allocate_exited(size_t c);
+    inline void deallocate_exited(free_object* fo, size_t c) noexcept;
+};
+
+inline pool& pool::local() noexcept {
+    static_assert(std::is_trivially_destructible_v<pool>);
+    thread_local constinit pool p{};
+    return p;
+}
+
+inline auto pool::orphans() -> orphanage& {
+    // never destroyed, so it outlives every thread
+    static orphanage* o = new orphanage;
+    return *o;
+}
+
+inline void* pool::allocate(size_t sz) {
+    size_t c = size_class(sz);
+    if (c >= nclasses) {
+        ++counters_.large;
+        return ::operator new(sz);
+    }
+    if (!free_[c]) [[unlikely]] {
+        if (state_ == s_exited) {
+            return allocate_exited(c);
+        }
+        refill(c);
+    }
+    free_object* fo = free_[c];
+    free_[c] = fo->next;
+    ++counters_.allocations;
+    return fo;
+}
+
+inline void pool::deallocate(void* p, size_t sz) noexcept {
+    size_t c = size_class(sz);
+    if (c >= nclasses) {
+        ::operator delete(p, sz);
+        return;
+    }
+    auto fo = static_cast<free_object*>(p);
+    if (state_ != s_live) [[unlikely]] {
+        if (state_ == s_exited) {
+            deallocate_exited(fo, c);
+            return;
+        }
+        start();
+    }
+    fo->next = free_[c];
+    free_[c] = fo;
+    ++counters_.frees;
+}
+
+// pool::start()
+//    Register the thread-exit hook that hands this pool’s freelists to the
+//    orphanage.
+
+inline void pool::start() {
+    struct exit_hook {
+        ~exit_hook() {
+            local().orphan();
+        }
+    };
+    thread_local exit_hook hook;
+    (void) hook;
+    state_ = s_live;
+}
+
+inline void pool::orphan() noexcept {
+    auto& o = orphans();
+    std::lock_guard lock(o.mutex);
+    for (size_t c = 0; c != nclasses; ++c) {
+        if (free_object* head = free_[c]) {
+            free_object* tail = head;
+            while (tail->next) {
+                tail = tail->next;
+            }
+            tail->next = o.free[c];
+            o.free[c] = head;
+            free_[c] = nullptr;
+        }
+    }
+    state_ = s_exited;
+}
+
+inline void pool::refill(size_t c) {
+    if (state_ == s_new) {
+        start();
+    }
+    auto& o = orphans();
+    std::lock_guard lock(o.mutex);
+    if (o.free[c]) {
+        // adopt an orphaned freelist
+        free_[c] = o.free[c];
+        o.free[c] = nullptr;
+    } else {
+        free_[c] = carve(o, c);
+    }
+}
+
+// Carve a new slab into a freelist for size class `c`. The orphanage must
+// be locked.
+inline auto pool::carve(orphanage& o, size_t c) -> free_object* {
+    size_t osz = (c + 1) * granule;
+    char* slab = static_cast<char*>(::operator new(slab_size));
+    o.slabs.push_back(slab);
+    ++counters_.slabs;
+    free_object* head = nullptr;
+    for (size_t off = slab_size - slab_size % osz; off != 0; ) {
+        off -= osz;
+        auto fo = reinterpret_cast<free_object*>(slab + off);
+        fo->next = head;
+        head = fo;
+    }
+    return head;
+}
+
+// After the exit hook runs, the thread allocates from and frees to the
+// orphanage.
+
+inline void* pool::allocate_exited(size_t c) {
+    auto& o = orphans();
+    std::lock_guard lock(o.mutex);
+    if (!o.free[c]) {
+        o.free[c] = carve(o, c);
+    }
+    free_object* fo = o.free[c];
+    o.free[c] = fo->next;
+    ++counters_.allocations;
+    return fo;
+}
+
+inline void pool::deallocate_exited(free_object* fo, size_t c) noexcept {
+    auto& o = orphans();
+    std::lock_guard lock(o.mutex);
+    fo->next = o.free[c];
+    o.free[c] = fo;
+    ++counters_.frees;
+}
+
+}
+}
@@ -0,0 +1,119 @@
+#pragma once
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <source_location>
+#include <unordered_map>
+#include <vector>
+
+// profile.hh
+//    Per-task profiler. Define COTAMER_PROFILE to 1 to enable it. Each task
+//    is tagged, when created, with the `std::source_location` of its
+//    coroutine function; the driver times every resumption and charges it to
+//    the resumed task’s tag. (Time spent in tasks that the resumed task
+//    starts or continues is charged to the resumed task.)
+//
+//    The profiler maps coroutine frames to tags in a hash table, so it costs
+//    a lookup per resumption and a table update per task. Each thread has its
+//    own profiler, which is emptied when the thread exits but never freed:
+//    task frames may be destroyed later in thread exit. Profilers stay
+//    reachable from a global list.
+
+#ifndef COTAMER_PROFILE
+#define COTAMER_PROFILE 0
+#endif
+
+namespace cotamer {
+namespace detail {
+
+class profiler {
+public:
+    struct tag {
+        std::source_location location;
+        uint64_t resumptions = 0;
+        std::chrono::nanoseconds time{0};
+    };
+
+    // Tag index for a coroutine that is not a known task.
+    static constexpr unsigned unknown = 0;
+
+    inline void add_task(void* frame, const std::source_location& loc);
+    void remove_task(void* frame) {
+        frames_.erase(frame);
+    }
+    inline unsigned tag_of(void* frame) const;
+    void record(unsigned t, std::chrono::nanoseconds d) {
+        ++tags_[t].resumptions;
+        tags_[t].time += d;
+    }
+
+    const std::vector<tag>& tags() const {
+        return tags_;
+    }
+
+    static profiler& local() {
+        thread_local constinit profiler* p = nullptr;
+        if (!p) [[unlikely]] {
+            p = create();
+        }
+        return *p;
+    }
+
+private:
+    // every profiler ever created
+    struct registry {
+        std::mutex mutex;
+        std::vector<profiler*> all;
+    };
+
+    static inline registry& profilers();
+    static inline profiler* create();
+
+    std::vector<tag> tags_ = std::vector<tag>(1);   // tags_[0] is unknown
+    std::unordered_map<const char*, unsigned> tag_index_;
+    std::unordered_map<void*, unsigned> frames_;
+};
+
+inline auto profiler::profilers() -> registry& {
+    // never destroyed, so it outlives every thread
+    static registry* r = new registry;
+    return *r;
+}
+
+inline profiler* profiler::create() {
+    // empty this thread’s profiler at thread exit
+    struct exit_hook {
+        profiler* p;
+        ~exit_hook() {
+            std::vector<tag>(1).swap(p->tags_);
+            decltype(tag_index_)().swap(p->tag_index_);
+            decltype(frames_)().swap(p->frames_);
+        }
+    };
+    profiler* p = new profiler;
+    {
+        auto& r = profilers();
+        std::lock_guard lock(r.mutex);
+        r.all.push_back(p);
+    }
+    thread_local exit_hook hook{p};
+    return p;
+}
+
+inline void profiler::add_task(void* frame, const std::source_location& loc) {
+    // `function_name()` strings are distinct per function, but a function
+    // may have several copies of its string; `task_profile()` merges them.
+    auto [it, inserted] = tag_index_.try_emplace(loc.function_name(), tags_.size());
+    if (inserted) {
+        tags_.push_back(tag{loc});
+    }
+    frames_[frame] = it->second;
+}
+
+inline unsigned profiler::tag_of(void* frame) const {
+    auto it = frames_.find(frame);
+    return it == frames_.end() ? unknown : it->second;
+}
+
+}
+}
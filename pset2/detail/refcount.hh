@@ -0,0 +1,61 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+
+// refcount.hh
+//    The reference count type for event bodies.
+//
+//    Events belong to the thread whose driver created them, and are never
+//    shared between threads, so by default the count is a plain integer.
+//    Define COTAMER_ATOMIC_REFCOUNT to 1 to use `std::atomic` instead, which
+//    is required if event handles may be copied or destroyed concurrently
+//    on different threads. Both types have the same interface; the memory
+//    orders are ignored by the plain version.
+//
+//    Timers are still owned by one driver. In atomic mode an event body
+//    remembers the driver that created it, and a handle dropped on another
+//    thread never cancels the event’s timer early; the timer just fires
+//    later on its own thread.
+
+#ifndef COTAMER_ATOMIC_REFCOUNT
+#define COTAMER_ATOMIC_REFCOUNT 0
+#endif
+
+namespace cotamer {
+namespace detail {
+
+template <typename T>
+class plain_refcount {
+public:
+    constexpr plain_refcount(T v) noexcept
+        : v_(v) {
+    }
+    plain_refcount(const plain_refcount<T>&) = delete;
+    plain_refcount<T>& operator=(const plain_refcount<T>&) = delete;
+
+    T load(std::memory_order = std::memory_order_seq_cst) const noexcept {
+        return v_;
+    }
+    T fetch_add(T x, std::memory_order = std::memory_order_seq_cst) noexcept {
+        T old = v_;
+        v_ = old + x;
+        return old;
+    }
+    T fetch_sub(T x, std::memory_order = std::memory_order_seq_cst) noexcept {
+        T old = v_;
+        v_ = old - x;
+        return old;
+    }
+
+private:
+    T v_;
+};
+
+#if COTAMER_ATOMIC_REFCOUNT
+using refcount_type = std::atomic<uint32_t>;
+#else
+using refcount_type = plain_refcount<uint32_t>;
+#endif
+
+}
+}
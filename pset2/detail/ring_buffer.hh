@@ -0,0 +1,126 @@
+#pragma once
+#include <cstddef>
+#include <memory>
+#include <utility>
+
+// ring_buffer.hh
+//    A FIFO queue stored in a power-of-two circular array. Capacity doubles
+//    when the queue fills and never shrinks, so a queue that has reached its
+//    working size stops allocating. `head_` and `tail_` count up forever and
+//    are masked on access.
+
+template <typename T>
+class ring_buffer {
+public:
+    using value_type = T;
+    using size_type = size_t;
+
+    ring_buffer() = default;
+    ring_buffer(const ring_buffer<T>&) = delete;
+    ring_buffer(ring_buffer<T>&&) = delete;
+    ring_buffer<T>& operator=(const ring_buffer<T>&) = delete;
+    ring_buffer<T>& operator=(ring_buffer<T>&&) = delete;
+    ~ring_buffer() {
+        clear();
+        if (buf_) {
+            std::allocator<T>().deallocate(buf_, cap_);
+        }
+    }
+
+    size_t size() const {
+        return tail_ - head_;
+    }
+    bool empty() const {
+        return head_ == tail_;
+    }
+    size_t capacity() const {
+        return cap_;
+    }
+
+    T& front() {
+        return buf_[head_ & mask_];
+    }
+    const T& front() const {
+        return buf_[head_ & mask_];
+    }
+    T& operator[](size_t i) {
+        return buf_[(head_ + i) & mask_];
+    }
+    const T& operator[](size_t i) const {
+        return buf_[(head_ + i) & mask_];
+    }
+
+    void push_back(const T& v) {
+        std::construct_at(push_space(), v);
+        ++tail_;
+    }
+    void push_back(T&& v) {
+        std::construct_at(push_space(), std::move(v));
+        ++tail_;
+    }
+    void pop_front() {
+        std::destroy_at(&buf_[head_ & mask_]);
+        ++head_;
+    }
+
+    void clear() {
+        while (!empty()) {
+            pop_front();
+        }
+    }
+
+    // Remove every element equal to `v`, preserving the order of the rest.
+    // Returns the number removed.
+    template <typename U>
+    size_t erase(const U& v) {
+        size_t w = head_;
+        for (size_t r = head_; r != tail_; ++r) {
+            if (!(buf_[r & mask_] == v)) {
+                if (w != r) {
+                    buf_[w & mask_] = std::move(buf_[r & mask_]);
+                }
+                ++w;
+            }
+        }
+        size_t n = tail_ - w;
+        while (tail_ != w) {
+            --tail_;
+            std::destroy_at(&buf_[tail_ & mask_]);
+        }
+        return n;
+    }
+
+private:
+    T* buf_ = nullptr;
+    size_t mask_ = 0;
+    size_t head_ = 0;
+    size_t tail_ = 0;
+    size_t cap_ = 0;
+
+    T* push_space() {
+        if (tail_ - head_ == cap_) {
+            grow();
+        }
+        return &buf_[tail_ & mask_];
+    }
+
+    void grow() {
+        std::allocator<T> alloc;
+        size_t cap = cap_ ? cap_ * 2 : 16;
+        T* newbuf = alloc.allocate(cap);
+        size_t n = size();
+        for (size_t i = 0; i != n; ++i) {
+            T& x = buf_[(head_ + i) & mask_];
+            std::construct_at(&newbuf[i], std::move(x));
+            std::destroy_at(&x);
+        }
+        if (buf_) {
+            alloc.deallocate(buf_, cap_);
+        }
+        buf_ = newbuf;
+        mask_ = cap - 1;
+        cap_ = cap;
+        head_ = 0;
+        tail_ = n;
+    }
+};
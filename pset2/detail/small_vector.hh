@@ -57,23 +57,26 @@ struct small_vector {
         return begin() + size();
     }
 
-    T* push_space() {
+    size_t capacity() const {
+        return cap_;
+    }
+    void reserve(size_t n) {
         if (cap_ == 0) {
             cap_ = N;
         }
-        if (sz_ < cap_) {
-            return end();
+        if (n > cap_) {
+            grow(n);
         }
-        std::allocator<T> alloc;
-        T* newptr = alloc.allocate(cap_ * 2);
-        std::uninitialized_move_n(begin(), sz_, newptr);
-        std::destroy_n(begin(), sz_);
-        if (cap_ > N) {
-            alloc.deallocate(u_.out, cap_);
+    }
+
+    T* push_space() {
+        if (cap_ == 0) {
+            cap_ = N;
         }
-        u_.out = newptr;
-        cap_ *= 2;
-        return u_.out + sz_;
+        if (sz_ == cap_) {
+            grow(cap_ * 2);
+        }
+        return end();
     }
 
     T& front() {
@@ -103,6 +106,18 @@ struct small_vector {
     }
 
 private:
+    void grow(size_t n) {
+        std::allocator<T> alloc;
+        T* newptr = alloc.allocate(n);
+        std::uninitialized_move_n(begin(), sz_, newptr);
+        std::destroy_n(begin(), sz_);
+        if (cap_ > N) {
+            alloc.deallocate(u_.out, cap_);
+        }
+        u_.out = newptr;
+        cap_ = n;
+    }
+
     uint32_t sz_ = 0;
     uint32_t cap_ = N;
     union {
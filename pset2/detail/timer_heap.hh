@@ -1,6 +1,8 @@
 #pragma once
 #include "detail/circular_int.hh"
+#include <cassert>
 #include <chrono>
+#include <memory>
 
 template <typename T>
 struct empty {
@@ -9,11 +11,36 @@ struct empty {
     }
 };
 
+// Define COTAMER_TIMER_WHEEL to 1 to make `timer_wheel` (in
+// `timer_wheel.hh`) the default timer queue.
+#ifndef COTAMER_TIMER_WHEEL
+#define COTAMER_TIMER_WHEEL 0
+#endif
+
+// Timer values that define `set_timer_index(unsigned)` are told their heap
+// position whenever it changes, and `timer_heap::npos` when they leave the
+// heap. They can then be cancelled with `timer_heap::erase`.
+template <typename T>
+concept indexed_timer = requires (T& x, unsigned i) { x.set_timer_index(i); };
+
 template <typename T>
 struct timer_heap_traits {
     using empty_type = empty<T>;
     using time_point_type = std::chrono::system_clock::time_point;
     static constexpr int arity = 4;
+    static constexpr bool wheel = COTAMER_TIMER_WHEEL;
+    static constexpr bool indexed = indexed_timer<T>;
+    static void set_index(T& x, unsigned i) {
+        if constexpr (indexed) {
+            x.set_timer_index(i);
+        }
+    }
+};
+
+struct timer_counters {
+    uint64_t inserted = 0;      // timers added
+    uint64_t cancelled = 0;     // timers removed by `erase`
+    uint64_t culled = 0;        // dead timers found and removed
 };
 
 template <typename T>
@@ -25,6 +52,7 @@ struct timer_heap {
     using value_type = T;
     using reference = T&;
     using size_type = unsigned;
+    static constexpr unsigned npos = ~0U;
     static_assert(arity >= 2);
 
     timer_heap() = default;
@@ -39,11 +67,18 @@ struct timer_heap {
     inline time_point_type top_time() const;
     inline T& top() &;
     inline const T& top() const&;
+    inline const T& at(unsigned pos) const;
     void emplace(time_point_type t, T&& value);
     inline void pop();
+    inline T take_top();
+    inline void erase(unsigned pos);
     inline void cull();
     void clear();
 
+    const timer_counters& stats() const {
+        return stats_;
+    }
+
   private:
     struct element {
         time_point_type when;
@@ -58,10 +93,13 @@ struct timer_heap {
     unsigned capacity_ = 0;
     unsigned order_ = 0;         // next `order` to insert
     unsigned cull_rand_ = 8173;  // random seed for `cull`
+    timer_counters stats_;
 
     static inline unsigned heap_parent(unsigned i);
     static inline unsigned heap_first_child(unsigned i);
     inline unsigned heap_last_child(unsigned i) const;
+    inline void set_index(unsigned pos);
+    inline void swap_elements(unsigned a, unsigned b);
     void hard_cull(unsigned pos);
     void expand();
 };
@@ -69,7 +107,7 @@ struct timer_heap {
 
 template <typename T>
 inline timer_heap<T>::~timer_heap() {
-    std::destroy_n(es_, size_);
+    clear();
     std::allocator<element> alloc;
     alloc.deallocate(es_, capacity_);
 }
@@ -90,6 +128,12 @@ inline auto timer_heap<T>::top_time() const -> time_point_type {
     return es_[0].when;
 }
 
+template <typename T>
+inline const T& timer_heap<T>::at(unsigned pos) const {
+    assert(pos < size_);
+    return es_[pos].value;
+}
+
 template <typename T>
 inline T& timer_heap<T>::top() & {
     assert(size_ != 0);
@@ -105,6 +149,7 @@ inline const T& timer_heap<T>::top() const& {
 template <typename T>
 inline void timer_heap<T>::cull() {
     while (size_ != 0 && empty_type{}(es_[0].value)) {
+        ++stats_.culled;
         hard_cull(0);
     }
 }
@@ -136,12 +181,46 @@ inline void timer_heap<T>::pop() {
     hard_cull(0);
 }
 
+// Remove the earliest timer and return its value.
+template <typename T>
+inline T timer_heap<T>::take_top() {
+    assert(size_ != 0);
+    traits_type::set_index(es_[0].value, npos);
+    T value = std::move(es_[0].value);
+    hard_cull(0);
+    return value;
+}
+
+// Cancel the timer at heap position `pos`, as reported by `set_index`.
+template <typename T>
+inline void timer_heap<T>::erase(unsigned pos) {
+    assert(pos < size_);
+    ++stats_.cancelled;
+    hard_cull(pos);
+}
+
 template <typename T>
 void timer_heap<T>::clear() {
+    for (unsigned i = 0; i != size_; ++i) {
+        traits_type::set_index(es_[i].value, npos);
+    }
     std::destroy_n(es_, size_);
     size_ = 0;
 }
 
+template <typename T>
+inline void timer_heap<T>::set_index(unsigned pos) {
+    traits_type::set_index(es_[pos].value, pos);
+}
+
+template <typename T>
+inline void timer_heap<T>::swap_elements(unsigned a, unsigned b) {
+    using std::swap;
+    swap(es_[a], es_[b]);
+    set_index(a);
+    set_index(b);
+}
+
 template <typename T>
 void timer_heap<T>::expand() {
     unsigned ncap = (capacity_ ? (capacity_ * 4) + 3 : 31);
@@ -158,8 +237,6 @@ void timer_heap<T>::expand() {
 
 template <typename T>
 void timer_heap<T>::emplace(time_point_type when, T&& value) {
-    using std::swap;
-
     // Append new trec
     unsigned pos = size_;
     if (pos == capacity_) {
@@ -167,6 +244,8 @@ void timer_heap<T>::emplace(time_point_type when, T&& value) {
     }
     std::construct_at(es_ + pos, when, ++order_, std::move(value));
     ++size_;
+    ++stats_.inserted;
+    set_index(pos);
 
     // Swap trec to proper position in heap
     while (pos != 0) {
@@ -174,36 +253,44 @@ void timer_heap<T>::emplace(time_point_type when, T&& value) {
         if (!(es_[pos] < es_[p])) {
             break;
         }
-        swap(es_[pos], es_[p]);
+        swap_elements(pos, p);
         pos = p;
     }
 
     // If heap is largish, check to see if a random element is empty.
     // If it's empty, remove it, and look for another empty element.
     // This should help keep the timer heap small even if we set many
-    // more timers than get a chance to fire.
-    while (size_ >= 32) {
-        pos = cull_rand_ % size_;
-        cull_rand_ = cull_rand_ * 1664525 + 1013904223U; // Numerical Recipes LCG
-        if (!empty_type{}(es_[pos].value)) {
-            break;
+    // more timers than get a chance to fire. Indexed timers are erased as
+    // soon as they die, so they don’t need this.
+    if constexpr (!traits_type::indexed) {
+        while (size_ >= 32) {
+            pos = cull_rand_ % size_;
+            cull_rand_ = cull_rand_ * 1664525 + 1013904223U; // Numerical Recipes LCG
+            if (!empty_type{}(es_[pos].value)) {
+                break;
+            }
+            ++stats_.culled;
+            hard_cull(pos);
         }
-        hard_cull(pos);
     }
 }
 
 template <typename T>
 void timer_heap<T>::hard_cull(unsigned pos) {
-    using std::swap;
     assert(size_ != 0);
 
+    // Destroy the removed value only after the heap is consistent again:
+    // dropping an event reference can run arbitrary code.
     --size_;
+    if (pos != size_) {
+        swap_elements(size_, pos);
+    }
+    traits_type::set_index(es_[size_].value, npos);
+    T dead(std::move(es_[size_].value));
+    std::destroy_at(es_ + size_);
     if (pos == size_) {
-        std::destroy_at(es_ + pos);
         return;
     }
-    swap(es_[size_], es_[pos]);
-    std::destroy_at(es_ + size_);
 
     if (pos == 0 || !(es_[pos] < es_[heap_parent(pos)])) {
         while (true) {
@@ -218,13 +305,13 @@ void timer_heap<T>::hard_cull(unsigned pos) {
             if (smallest == pos) {
                 break;
             }
-            swap(es_[pos], es_[smallest]);
+            swap_elements(pos, smallest);
             pos = smallest;
         }
     } else {
         do {
             unsigned p = heap_parent(pos);
-            swap(es_[pos], es_[p]);
+            swap_elements(pos, p);
             pos = p;
         } while (pos && es_[pos] < es_[heap_parent(pos)]);
     }
@@ -0,0 +1,247 @@
+#pragma once
+#include "detail/timer_heap.hh"
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <type_traits>
+#include <vector>
+
+// timer_wheel.hh
+//    A hierarchical timing wheel with the same interface as `timer_heap`.
+//    Times are converted to 64-bit ticks (one tick per clock period). Level
+//    `L` has 64 slots, each covering 64^L ticks; a timer lives at the level
+//    of the highest 6-bit digit in which its tick differs from the wheel’s
+//    cursor. Inserting is O(1). Finding the next timer takes the lowest
+//    occupied slot, moves the cursor to the earliest timer in it, and
+//    redistributes the rest into lower levels; each timer is moved at most
+//    once per level, so expiry is amortized O(1).
+//
+//    Timers at or before the cursor live in `current_`, a vector sorted by
+//    (time, insertion order), so timers pop in exactly the same order as
+//    from `timer_heap`. Empty timers are culled lazily, when they reach
+//    `current_` or when their slot is redistributed; the wheel does not
+//    track timer positions, so it does not support `erase`.
+
+template <typename T>
+struct timer_wheel {
+    using traits_type = timer_heap_traits<T>;
+    using empty_type = typename traits_type::empty_type;
+    using time_point_type = typename traits_type::time_point_type;
+    using value_type = T;
+    using reference = T&;
+    using size_type = unsigned;
+
+    timer_wheel() = default;
+    timer_wheel(const timer_wheel&) = delete;
+    timer_wheel(timer_wheel&&) = delete;
+    timer_wheel& operator=(const timer_wheel&) = delete;
+    timer_wheel& operator=(timer_wheel&&) = delete;
+
+    inline bool empty() const;
+    inline unsigned size() const;
+    inline time_point_type top_time();
+    inline T& top() &;
+    void emplace(time_point_type t, T&& value);
+    inline void pop();
+    inline T take_top();
+    inline void cull();
+    void clear();
+
+    const timer_counters& stats() const {
+        return stats_;
+    }
+
+  private:
+    static constexpr int slot_bits = 6;
+    static constexpr unsigned nslots = 1U << slot_bits;
+    static constexpr int nlevels = (64 + slot_bits - 1) / slot_bits;
+
+    struct element {
+        time_point_type when;
+        circular_int<unsigned> order;
+        value_type value;
+
+        inline bool operator<(const element &x) const noexcept;
+    };
+
+    std::vector<element> current_;  // sorted; live part starts at `chead_`
+    unsigned chead_ = 0;
+    uint64_t cursor_ = 0;
+    uint64_t occupied_[nlevels] = {};
+    std::vector<element> slots_[nlevels][nslots];
+    std::vector<element> scratch_;
+    unsigned size_ = 0;
+    unsigned order_ = 0;            // next `order` to insert
+    timer_counters stats_;
+
+    static inline uint64_t tick(time_point_type t);
+    inline void place(element&& e);
+    void advance(bool cull);
+};
+
+
+template <typename T>
+inline uint64_t timer_wheel<T>::tick(time_point_type t) {
+    // Map signed clock counts onto unsigned ticks, preserving order
+    return uint64_t(t.time_since_epoch().count()) ^ (uint64_t(1) << 63);
+}
+
+template <typename T>
+inline bool timer_wheel<T>::element::operator<(const element &x) const noexcept {
+    auto cmp = when <=> x.when;
+    return cmp < 0 || (cmp == 0 && order < x.order);
+}
+
+template <typename T>
+inline bool timer_wheel<T>::empty() const {
+    return size_ == 0;
+}
+
+template <typename T>
+inline unsigned timer_wheel<T>::size() const {
+    return size_;
+}
+
+template <typename T>
+inline auto timer_wheel<T>::top_time() -> time_point_type {
+    assert(size_ != 0);
+    if (chead_ == current_.size()) {
+        advance(false);
+    }
+    return current_[chead_].when;
+}
+
+template <typename T>
+inline T& timer_wheel<T>::top() & {
+    assert(size_ != 0);
+    if (chead_ == current_.size()) {
+        advance(false);
+    }
+    return current_[chead_].value;
+}
+
+template <typename T>
+inline void timer_wheel<T>::pop() {
+    assert(chead_ != current_.size());
+    current_[chead_].value = T();
+    ++chead_;
+    --size_;
+    if (chead_ == current_.size()) {
+        current_.clear();
+        chead_ = 0;
+    }
+}
+
+// Remove the earliest timer and return its value.
+template <typename T>
+inline T timer_wheel<T>::take_top() {
+    T value = std::move(top());
+    pop();
+    return value;
+}
+
+template <typename T>
+inline void timer_wheel<T>::cull() {
+    while (size_ != 0) {
+        if (chead_ == current_.size()) {
+            advance(true);
+        } else if (empty_type{}(current_[chead_].value)) {
+            ++stats_.culled;
+            pop();
+        } else {
+            break;
+        }
+    }
+}
+
+template <typename T>
+void timer_wheel<T>::clear() {
+    current_.clear();
+    chead_ = 0;
+    for (int l = 0; l != nlevels; ++l) {
+        while (occupied_[l]) {
+            unsigned s = std::countr_zero(occupied_[l]);
+            slots_[l][s].clear();
+            occupied_[l] &= occupied_[l] - 1;
+        }
+    }
+    size_ = 0;
+}
+
+template <typename T>
+inline void timer_wheel<T>::place(element&& e) {
+    uint64_t t = tick(e.when);
+    int level = (std::bit_width(t ^ cursor_) - 1) / slot_bits;
+    unsigned s = (t >> (level * slot_bits)) & (nslots - 1);
+    slots_[level][s].push_back(std::move(e));
+    occupied_[level] |= uint64_t(1) << s;
+}
+
+template <typename T>
+void timer_wheel<T>::emplace(time_point_type when, T&& value) {
+    element e{when, ++order_, std::move(value)};
+    if (tick(when) <= cursor_) {
+        // Due already: keep `current_` sorted. New timers have the largest
+        // `order`, so they go after every timer with the same time.
+        auto it = std::upper_bound(current_.begin() + chead_, current_.end(), e);
+        current_.insert(it, std::move(e));
+    } else {
+        place(std::move(e));
+    }
+    ++size_;
+    ++stats_.inserted;
+}
+
+template <typename T>
+void timer_wheel<T>::advance(bool cull) {
+    // Every occupied slot at level L lies after the cursor’s level-L digit,
+    // so the earliest timer is in the lowest occupied slot of the lowest
+    // occupied level. Move the cursor to that timer; timers due at the new
+    // cursor go to `current_`, and the rest of the slot moves down.
+    assert(chead_ == current_.size());
+    current_.clear();
+    chead_ = 0;
+    while (current_.empty() && size_ != 0) {
+        int level = 0;
+        while (occupied_[level] == 0) {
+            ++level;
+            assert(level < nlevels);
+        }
+        unsigned s = std::countr_zero(occupied_[level]);
+        occupied_[level] &= ~(uint64_t(1) << s);
+        scratch_.swap(slots_[level][s]);   // the slot keeps scratch’s buffer
+
+        if (cull) {
+            auto n = std::erase_if(scratch_, [] (const element& e) {
+                return empty_type{}(e.value);
+            });
+            size_ -= n;
+            stats_.culled += n;
+        }
+        uint64_t first = ~uint64_t(0);
+        for (auto& e : scratch_) {
+            first = std::min(first, tick(e.when));
+        }
+        if (!scratch_.empty()) {
+            cursor_ = first;
+        }
+        for (auto& e : scratch_) {
+            if (tick(e.when) == first) {
+                current_.push_back(std::move(e));
+            } else {
+                place(std::move(e));
+            }
+        }
+        scratch_.clear();
+    }
+    std::sort(current_.begin(), current_.end());
+}
+
+
+// timer_queue<T>
+//    The timer queue type for `T`: `timer_wheel<T>` if
+//    `timer_heap_traits<T>::wheel` is true, otherwise `timer_heap<T>`.
+
+template <typename T>
+using timer_queue = std::conditional_t<timer_heap_traits<T>::wheel,
+                                       timer_wheel<T>, timer_heap<T>>;
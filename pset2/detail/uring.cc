@@ -0,0 +1,235 @@
+#if __linux__
+#include "detail/uring.hh"
+#include "detail/poller.hh"
+#include "cotamer.hh"
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <system_error>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace cotamer {
+namespace detail {
+
+namespace {
+[[noreturn]] void throw_errno(const char* what) {
+    throw std::system_error(errno, std::generic_category(), what);
+}
+
+inline unsigned load_acquire(unsigned* p) {
+    return std::atomic_ref<unsigned>(*p).load(std::memory_order_acquire);
+}
+
+inline void store_release(unsigned* p, unsigned v) {
+    std::atomic_ref<unsigned>(*p).store(v, std::memory_order_release);
+}
+
+constexpr uint8_t opcodes[] = {
+    IORING_OP_READ, IORING_OP_WRITE, IORING_OP_RECV, IORING_OP_SEND,
+    IORING_OP_ACCEPT, IORING_OP_CONNECT
+};
+}
+
+uring::uring(unsigned entries) {
+    io_uring_params p{};
+    p.flags = IORING_SETUP_CLAMP;
+    fd_ = syscall(__NR_io_uring_setup, entries, &p);
+    if (fd_ < 0) {
+        throw_errno("io_uring_setup");
+    }
+
+    sq_map_size_ = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+    cq_map_size_ = p.cq_off.cqes + p.cq_entries * sizeof(io_uring_cqe);
+    bool single_mmap = p.features & IORING_FEAT_SINGLE_MMAP;
+    if (single_mmap) {
+        sq_map_size_ = cq_map_size_ = std::max(sq_map_size_, cq_map_size_);
+    }
+    sqes_size_ = p.sq_entries * sizeof(io_uring_sqe);
+    void* sqes = MAP_FAILED;
+    sq_map_ = mmap(nullptr, sq_map_size_, PROT_READ | PROT_WRITE,
+                   MAP_SHARED | MAP_POPULATE, fd_, IORING_OFF_SQ_RING);
+    if (sq_map_ != MAP_FAILED) {
+        cq_map_ = single_mmap ? sq_map_
+            : mmap(nullptr, cq_map_size_, PROT_READ | PROT_WRITE,
+                   MAP_SHARED | MAP_POPULATE, fd_, IORING_OFF_CQ_RING);
+    }
+    if (sq_map_ != MAP_FAILED && cq_map_ != MAP_FAILED) {
+        sqes = mmap(nullptr, sqes_size_, PROT_READ | PROT_WRITE,
+                    MAP_SHARED | MAP_POPULATE, fd_, IORING_OFF_SQES);
+    }
+    if (sqes == MAP_FAILED) {
+        int err = errno;
+        if (cq_map_ != MAP_FAILED && cq_map_ != sq_map_ && cq_map_) {
+            munmap(cq_map_, cq_map_size_);
+        }
+        if (sq_map_ != MAP_FAILED) {
+            munmap(sq_map_, sq_map_size_);
+        }
+        ::close(fd_);
+        throw std::system_error(err, std::generic_category(), "io_uring mmap");
+    }
+
+    char* sq = static_cast<char*>(sq_map_);
+    sq_head_ = reinterpret_cast<unsigned*>(sq + p.sq_off.head);
+    sq_tail_ = reinterpret_cast<unsigned*>(sq + p.sq_off.tail);
+    sq_flags_ = reinterpret_cast<unsigned*>(sq + p.sq_off.flags);
+    sq_mask_ = *reinterpret_cast<unsigned*>(sq + p.sq_off.ring_mask);
+    sq_entries_ = p.sq_entries;
+    sqes_ = static_cast<io_uring_sqe*>(sqes);
+    // submission queue entry i always lives in `sqes_[i]`
+    unsigned* sq_array = reinterpret_cast<unsigned*>(sq + p.sq_off.array);
+    for (unsigned i = 0; i != sq_entries_; ++i) {
+        sq_array[i] = i;
+    }
+    char* cq = static_cast<char*>(cq_map_);
+    cq_head_ = reinterpret_cast<unsigned*>(cq + p.cq_off.head);
+    cq_tail_ = reinterpret_cast<unsigned*>(cq + p.cq_off.tail);
+    cq_mask_ = *reinterpret_cast<unsigned*>(cq + p.cq_off.ring_mask);
+    cqes_ = reinterpret_cast<io_uring_cqe*>(cq + p.cq_off.cqes);
+}
+
+uring::~uring() {
+    cancel_all();
+    munmap(sqes_, sqes_size_);
+    if (cq_map_ != sq_map_) {
+        munmap(cq_map_, cq_map_size_);
+    }
+    munmap(sq_map_, sq_map_size_);
+    ::close(fd_);
+}
+
+
+io_uring_sqe* uring::next_sqe() {
+    unsigned tail = *sq_tail_;
+    if (tail - load_acquire(sq_head_) == sq_entries_) {
+        // submission queue full: submit early
+        enter(0);
+        if (tail - load_acquire(sq_head_) == sq_entries_) {
+            throw std::system_error(EBUSY, std::generic_category(), "io_uring_enter");
+        }
+    }
+    io_uring_sqe* sqe = &sqes_[tail & sq_mask_];
+    memset(sqe, 0, sizeof(*sqe));
+    return sqe;
+}
+
+void uring::enter(unsigned min_complete) {
+    int r = syscall(__NR_io_uring_enter, fd_, queued_, min_complete,
+                    IORING_ENTER_GETEVENTS, nullptr, 0);
+    if (r < 0) {
+        if (errno == EINTR || errno == EAGAIN || errno == EBUSY) {
+            return;                 // try again on the next flush
+        }
+        throw_errno("io_uring_enter");
+    }
+    queued_ -= std::min(unsigned(r), queued_);
+}
+
+void uring::start(io_awaiter* aw) {
+    io_uring_sqe* sqe = next_sqe();
+    sqe->opcode = opcodes[int(aw->op_)];
+    sqe->fd = aw->fd_;
+    sqe->addr = aw->addr_;
+    sqe->len = aw->len_;
+    sqe->off = aw->off_;
+    sqe->rw_flags = aw->flags_;    // `msg_flags`, `accept_flags`, ...
+    sqe->user_data = reinterpret_cast<uintptr_t>(aw);
+    store_release(sq_tail_, *sq_tail_ + 1);
+    ++queued_;
+    ++inflight_;
+    aw->state_ = io_awaiter::s_inflight;
+}
+
+void uring::flush() {
+    if (queued_ != 0
+        || (load_acquire(sq_flags_) & IORING_SQ_CQ_OVERFLOW)) {
+        enter(0);
+    }
+    harvest();
+}
+
+void uring::harvest() {
+    unsigned head = *cq_head_;
+    unsigned tail = load_acquire(cq_tail_);
+    while (head != tail) {
+        io_uring_cqe& cqe = cqes_[head & cq_mask_];
+        auto aw = reinterpret_cast<io_awaiter*>(cqe.user_data);
+        int res = cqe.res;
+        store_release(cq_head_, ++head);
+        if (aw) {                   // null for cancellations
+            --inflight_;
+            aw->complete(res);
+        }
+    }
+}
+
+void uring::abandon(io_awaiter* aw) {
+    io_uring_sqe* sqe = next_sqe();
+    sqe->opcode = IORING_OP_ASYNC_CANCEL;
+    sqe->fd = -1;
+    sqe->addr = reinterpret_cast<uintptr_t>(aw);
+    store_release(sq_tail_, *sq_tail_ + 1);
+    ++queued_;
+    aw->state_ = io_awaiter::s_abandoned;
+    while (aw->state_ == io_awaiter::s_abandoned) {
+        enter(1);
+        harvest();
+    }
+}
+
+void uring::cancel_all() {
+    if (inflight_ == 0) {
+        return;
+    }
+    io_uring_sqe* sqe = next_sqe();
+    sqe->opcode = IORING_OP_ASYNC_CANCEL;
+    sqe->fd = -1;
+    sqe->cancel_flags = IORING_ASYNC_CANCEL_ANY;
+    store_release(sq_tail_, *sq_tail_ + 1);
+    ++queued_;
+    while (inflight_ != 0) {
+        enter(1);
+        harvest();
+    }
+}
+
+
+// io_awaiter
+
+std::coroutine_handle<> io_awaiter::await_suspend(std::coroutine_handle<> awaiting) {
+    auto& d = driver::current();
+    if (!d.poller_) {
+        throw std::logic_error("cotamer::io requires a real-time driver");
+    }
+    handle_ = awaiting;
+    d.poller_->ring().start(this);
+    return d.transfer_from(awaiting.address());
+}
+
+void io_awaiter::complete(int res) {
+    if (state_ == s_abandoned) {
+        state_ = s_idle;
+        return;
+    }
+    result_ = res;
+    state_ = s_done;
+    driver::current().make_ready(handle_);
+}
+
+void io_awaiter::abandon() {
+    auto& d = driver::current();
+    if (state_ == s_inflight) {
+        d.poller_->ring().abandon(this);
+    } else if (state_ == s_done) {
+        d.ready_.erase(handle_);
+    }
+    state_ = s_idle;
+}
+
+}
+}
+#endif
@@ -0,0 +1,83 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <linux/io_uring.h>
+
+// uring.hh
+//    An io_uring submission and completion queue pair, set up with raw
+//    system calls, for `cotamer::io` operations on real-time drivers. The
+//    poller creates it on first use and registers its fd with epoll, so the
+//    loop sleeps on I/O completions along with timers and fd readiness.
+//
+//    `co_await io::read(...)` and friends fill in a submission queue entry
+//    whose user data is the awaiter, and suspend. Entries are not submitted
+//    right away: `flush()`, called once per loop iteration, submits all
+//    queued entries with a single `io_uring_enter`, then harvests
+//    completions (from shared memory, without a system call) into the
+//    driver’s ready queue.
+//
+//    An awaiter destroyed with its operation in flight (say, because its
+//    task was destroyed) cancels the operation and waits for it to
+//    complete, since the kernel may still write to the awaiter’s buffer.
+//    `cancel_all()` does the same for every operation while the driver
+//    clears.
+
+namespace cotamer {
+namespace detail {
+struct io_awaiter;
+
+class uring {
+public:
+    explicit uring(unsigned entries);
+    ~uring();
+    uring(const uring&) = delete;
+    uring(uring&&) = delete;
+    uring& operator=(const uring&) = delete;
+    uring& operator=(uring&&) = delete;
+
+    int fd() const noexcept {
+        return fd_;
+    }
+    // Number of operations submitted or queued and not yet harvested.
+    unsigned inflight() const noexcept {
+        return inflight_;
+    }
+
+    // Queue `aw`’s operation.
+    void start(io_awaiter* aw);
+    // Submit queued operations and harvest completions.
+    void flush();
+    // Cancel `aw`’s operation and wait for it to complete.
+    void abandon(io_awaiter* aw);
+    // Cancel all operations and wait for them to complete.
+    void cancel_all();
+
+private:
+    int fd_ = -1;
+    unsigned inflight_ = 0;
+    unsigned queued_ = 0;           // filled entries not yet submitted
+
+    unsigned* sq_head_;
+    unsigned* sq_tail_;
+    unsigned* sq_flags_;
+    unsigned sq_mask_;
+    unsigned sq_entries_;
+    io_uring_sqe* sqes_;
+    unsigned* cq_head_;
+    unsigned* cq_tail_;
+    unsigned cq_mask_;
+    io_uring_cqe* cqes_;
+
+    void* sq_map_ = nullptr;
+    size_t sq_map_size_ = 0;
+    void* cq_map_ = nullptr;
+    size_t cq_map_size_ = 0;
+    size_t sqes_size_ = 0;
+
+    io_uring_sqe* next_sqe();
+    void enter(unsigned min_complete);
+    void harvest();
+};
+
+}
+}
@@ -0,0 +1,266 @@
+#include "cotamer.hh"
+#include <cerrno>
+#include <cstring>
+#include <print>
+#include <string>
+#include <system_error>
+#include <sys/socket.h>
+#include <unistd.h>
+#if __linux__
+#include <netinet/in.h>
+#endif
+
+// echo.cc
+//    Echo a message over a socket pair on a real-time driver. One task
+//    writes the message, an echo task copies it back, and a third task reads
+//    the echo; they wait for the nonblocking sockets with `readable()` and
+//    `writable()`. A timer task checks the driver’s clock meanwhile.
+//
+//    On Linux, the message is then echoed again with `io::` operations: over
+//    a pipe with `io::read` and `io::write`, and over a loopback TCP
+//    connection with `io::accept`, `io::connect`, `io::recv`, and `io::send`.
+//    If the system refuses to create an io_uring, that part is skipped.
+
+namespace cot = cotamer;
+using namespace std::chrono_literals;
+
+static constexpr size_t message_size = 1 << 20;
+
+
+// Write all of `buf[0, n)` to nonblocking `fd`.
+static cot::task<> write_all(int fd, const char* buf, size_t n) {
+    while (n != 0) {
+        ssize_t w = write(fd, buf, n);
+        if (w >= 0) {
+            buf += w;
+            n -= w;
+        } else if (errno == EAGAIN) {
+            co_await cot::writable(fd);
+        } else {
+            throw std::system_error(errno, std::generic_category(), "write");
+        }
+    }
+}
+
+// Read at most `n` bytes from nonblocking `fd`. Returns 0 at end of file.
+static cot::task<size_t> read_some(int fd, char* buf, size_t n) {
+    while (true) {
+        ssize_t r = read(fd, buf, n);
+        if (r >= 0) {
+            co_return r;
+        } else if (errno != EAGAIN) {
+            throw std::system_error(errno, std::generic_category(), "read");
+        }
+        co_await cot::readable(fd);
+    }
+}
+
+
+static cot::task<> echo(int fd) {
+    char buf[8192];
+    while (size_t n = co_await read_some(fd, buf, sizeof(buf))) {
+        co_await write_all(fd, buf, n);
+    }
+    shutdown(fd, SHUT_WR);
+}
+
+static cot::task<> send_message(int fd, const std::string& message) {
+    co_await write_all(fd, message.data(), message.size());
+    shutdown(fd, SHUT_WR);
+}
+
+static cot::task<> receive_message(int fd, std::string& received) {
+    char buf[8192];
+    while (size_t n = co_await read_some(fd, buf, sizeof(buf))) {
+        received.append(buf, n);
+    }
+}
+
+static cot::task<> check_timer(bool& ok) {
+    auto start = cot::now();
+    co_await cot::after(5ms);
+    ok = cot::now() - start >= 5ms;
+}
+
+
+#if __linux__
+static void check_io(int r, const char* what) {
+    if (r < 0) {
+        throw std::system_error(-r, std::generic_category(), what);
+    }
+}
+
+// Write all of `buf[0, n)` with `io::send` if `socket`, else `io::write`.
+static cot::task<> io_write_all(int fd, const char* buf, size_t n, bool socket) {
+    while (n != 0) {
+        int w;
+        if (socket) {
+            w = co_await cot::io::send(fd, buf, n);
+        } else {
+            w = co_await cot::io::write(fd, buf, n);
+        }
+        check_io(w, socket ? "send" : "write");
+        buf += w;
+        n -= w;
+    }
+}
+
+// Read `fd` to end of file with `io::recv` if `socket`, else `io::read`.
+static cot::task<> io_read_all(int fd, std::string& received, bool socket) {
+    char buf[8192];
+    while (true) {
+        int r;
+        if (socket) {
+            r = co_await cot::io::recv(fd, buf, sizeof(buf));
+        } else {
+            r = co_await cot::io::read(fd, buf, sizeof(buf));
+        }
+        check_io(r, socket ? "recv" : "read");
+        if (r == 0) {
+            break;
+        }
+        received.append(buf, r);
+    }
+}
+
+static cot::task<> probe_io(int fd, bool& available) {
+    try {
+        check_io(co_await cot::io::read(fd, nullptr, 0), "read");
+        available = true;
+    } catch (const std::system_error& err) {
+        std::print(std::cerr, "cotamer-echo: {}; skipping io:: echo\n", err.what());
+    }
+}
+
+static cot::task<> pipe_writer(int fd, const std::string& message) {
+    co_await io_write_all(fd, message.data(), message.size(), false);
+    close(fd);
+}
+
+static cot::task<> io_echo(int listenfd) {
+    int fd = co_await cot::io::accept(listenfd);
+    check_io(fd, "accept");
+    char buf[8192];
+    while (true) {
+        int n = co_await cot::io::recv(fd, buf, sizeof(buf));
+        check_io(n, "recv");
+        if (n == 0) {
+            break;
+        }
+        co_await io_write_all(fd, buf, n, true);
+    }
+    close(fd);
+}
+
+static cot::task<> io_send_message(int fd, const std::string& message) {
+    co_await io_write_all(fd, message.data(), message.size(), true);
+    shutdown(fd, SHUT_WR);
+}
+
+static cot::task<> io_client(sockaddr_in addr, const std::string& message,
+                             std::string& received) {
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0) {
+        throw std::system_error(errno, std::generic_category(), "socket");
+    }
+    check_io(co_await cot::io::connect(fd, reinterpret_cast<sockaddr*>(&addr),
+                                       sizeof(addr)), "connect");
+    io_send_message(fd, message).detach();
+    co_await io_read_all(fd, received, true);
+    close(fd);
+}
+
+// Echo `message` through a pipe and a loopback connection. Returns false
+// on a mismatch.
+static bool io_echo_message(const std::string& message) {
+    int pfd[2];
+    if (pipe(pfd) != 0) {
+        throw std::system_error(errno, std::generic_category(), "pipe");
+    }
+    bool available = false;
+    probe_io(pfd[0], available).detach();
+    cot::loop();
+    if (!available) {
+        close(pfd[0]);
+        close(pfd[1]);
+        return true;
+    }
+
+    std::string piped;
+    pipe_writer(pfd[1], message).detach();
+    io_read_all(pfd[0], piped, false).detach();
+    cot::loop();
+    close(pfd[0]);
+    if (piped != message) {
+        std::print(std::cerr, "cotamer-echo: pipe echoed {} of {} bytes incorrectly\n",
+                   piped.size(), message.size());
+        return false;
+    }
+
+    int listenfd = socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t addrlen = sizeof(addr);
+    if (listenfd < 0
+        || bind(listenfd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0
+        || listen(listenfd, 1) != 0
+        || getsockname(listenfd, reinterpret_cast<sockaddr*>(&addr), &addrlen) != 0) {
+        throw std::system_error(errno, std::generic_category(), "listen");
+    }
+    std::string received;
+    io_echo(listenfd).detach();
+    io_client(addr, message, received).detach();
+    cot::loop();
+    close(listenfd);
+    if (received != message) {
+        std::print(std::cerr, "cotamer-echo: loopback echoed {} of {} bytes incorrectly\n",
+                   received.size(), message.size());
+        return false;
+    }
+    std::print("cotamer-echo: echoed {} bytes through io::\n", message.size());
+    return true;
+}
+#endif
+
+
+int main() {
+    cot::reset(cot::driver_mode::real_time);
+
+    int sv[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0, sv) != 0) {
+        std::print(std::cerr, "socketpair: {}\n", strerror(errno));
+        return 1;
+    }
+
+    std::string message(message_size, 0), received;
+    for (size_t i = 0; i != message.size(); ++i) {
+        message[i] = char(i * 7 + i / 251);
+    }
+    bool timer_ok = false;
+    echo(sv[1]).detach();
+    send_message(sv[0], message).detach();
+    receive_message(sv[0], received).detach();
+    check_timer(timer_ok).detach();
+    cot::loop();
+
+    for (int fd : sv) {
+        cot::forget_fd(fd);
+        close(fd);
+    }
+    if (received != message) {
+        std::print(std::cerr, "cotamer-echo: socket pair echoed {} of {} bytes incorrectly\n",
+                   received.size(), message.size());
+        return 1;
+    } else if (!timer_ok) {
+        std::print(std::cerr, "cotamer-echo: timer fired early\n");
+        return 1;
+    }
+    std::print("cotamer-echo: echoed {} bytes over a socket pair\n", message.size());
+
+#if __linux__
+    if (!io_echo_message(message)) {
+        return 1;
+    }
+#endif
+}
@@ -1,8 +1,29 @@
 #pragma once
 #include "cotamer.hh"
+#include <algorithm>
+#include <barrier>
+#include <cerrno>
 #include <concepts>
+#include <condition_variable>
+#include <cstdio>
+#include <fstream>
+#include <functional>
+#include <iterator>
+#include <latch>
 #include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
 #include <print>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <vector>
+#ifndef _WIN32
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
 #include "utils.hh"
 
 // netsim.hh
@@ -11,6 +32,13 @@
 //    * channel<T> -- represents a link between two servers
 //    * port<T> -- represents a receiving port on a server
 //    * network<T> -- looks up channels and ports by integer ID
+//    * random_log -- records or replays a simulation’s random draws
+//    * event_trace<P> -- records message events in a ring buffer
+//
+//    `network<T>::run_parallel` runs a simulation with its servers
+//    partitioned across threads (conservative parallel discrete-event
+//    simulation), and `network<T>::explore` forks a running simulation to
+//    explore many random continuations of it.
 
 
 namespace netsim {
@@ -22,6 +50,160 @@ template <typename T> struct message_traits;
 
 using id_type = int;       // type of server IDs
 
+namespace detail {
+// partition run by this thread during `network<T>::run_parallel`, or -1
+inline thread_local int current_partition = -1;
+}
+
+
+// random_log
+//    A log of a simulation’s random draws, for replaying a run without its
+//    seed. Attach one with `network<T>::randomness().set_log(&log)`. Each
+//    draw returns the log’s next value; once the log runs out, draws come
+//    from the generator and are appended, with their virtual times. So an
+//    empty log records a run, and a loaded one replays it. Cotamer’s
+//    scheduling is deterministic, so the draws determine the whole run and
+//    their times record its schedule: `diverged()` reports the first draw
+//    that a replay makes at a different time than the log did, for
+//    instance because the code changed.
+//
+//    Logs are handy for minimizing a failing run. A truncated log keeps a
+//    prefix of the run’s choices and re-randomizes the rest; edited values
+//    steer it (zeroing a value makes most distributions return their
+//    minimum). Draws made by `run_parallel` partitions use per-partition
+//    generators and are not logged, though their seeds are.
+//
+//    `save` writes the magic “NSRL”, then for each draw a varint of the
+//    zigzag-encoded nanoseconds since the previous draw and the 8-byte
+//    little-endian value.
+
+class random_log {
+public:
+    struct entry {
+        cot::clock::time_point when;
+        uint64_t value;
+    };
+
+    random_log() = default;
+    static inline random_log load(const std::string& path);
+    inline void save(const std::string& path) const;
+
+    std::vector<entry>& entries() noexcept { return entries_; }
+    const std::vector<entry>& entries() const noexcept { return entries_; }
+    // number of draws made so far
+    size_t position() const noexcept { return position_; }
+    std::optional<size_t> diverged() const noexcept { return diverged_; }
+
+    template <typename Engine>
+    inline uint64_t draw(Engine& engine);
+
+private:
+    std::vector<entry> entries_;
+    size_t position_ = 0;
+    std::optional<size_t> diverged_;
+};
+
+
+// random_source
+//    The generator behind `network<T>::randomness()`: a `std::mt19937_64`
+//    that can record its draws to, or replay them from, a `random_log`.
+
+class random_source {
+public:
+    using engine_type = std::mt19937_64;
+    using result_type = engine_type::result_type;
+
+    random_source() = default;
+    explicit random_source(engine_type engine)
+        : engine_(std::move(engine)) {
+    }
+
+    static constexpr result_type min() { return engine_type::min(); }
+    static constexpr result_type max() { return engine_type::max(); }
+    result_type operator()() {
+        if (log_) [[unlikely]] {
+            return log_->draw(engine_);
+        }
+        return engine_();
+    }
+
+    void seed(result_type s) { engine_.seed(s); }
+    engine_type& engine() noexcept { return engine_; }
+    random_log* log() const noexcept { return log_; }
+    void set_log(random_log* log) noexcept { log_ = log; }
+
+private:
+    engine_type engine_;
+    random_log* log_ = nullptr;
+};
+
+
+// event_trace<P>
+//    A ring buffer of message events, a fast alternative to verbose mode.
+//    Enable one with `network<T>::set_trace(capacity)`. Each send and
+//    receive stores a fixed-size binary event (time, source, destination,
+//    message ID, kind). The message’s printable form (`P`, the type returned
+//    by `message_traits<T>::print_transform`) is copied once, at send, into
+//    a second ring indexed by message ID. Nothing is formatted until
+//    `print`, which writes the events in verbose mode’s text format. Both
+//    rings grow to `capacity` entries; after that, new entries overwrite
+//    the oldest.
+//
+//    A message keeps the ID it got when sent, so a receive event names its
+//    send. A receive can outlive its message’s copy if more than `capacity`
+//    messages were sent in between; `print` then shows only the ID.
+//    Tracing is not supported in parallel runs.
+
+enum class trace_kind : uint8_t {
+    send, receive
+};
+
+template <typename P>
+class event_trace {
+public:
+    using message_type = P;
+
+    struct event {
+        cot::clock::time_point when;
+        uint64_t message_id;        // assigned at send; 1, 2, ...
+        id_type source;
+        id_type destination;
+        trace_kind kind;
+    };
+
+    explicit inline event_trace(size_t capacity);
+
+    // number of events retained (at most `capacity()`)
+    size_t size() const noexcept { return events_.size(); }
+    size_t capacity() const noexcept { return capacity_; }
+    // number of events overwritten
+    size_t dropped() const noexcept { return count_ - size(); }
+
+    // return the `i`th retained event, oldest first, and its message (null
+    // if the message’s copy was overwritten)
+    inline const event& at(size_t i) const noexcept;
+    inline const P* message(size_t i) const noexcept;
+
+    // record events; `send` returns the new message ID
+    inline uint64_t send(id_type src, id_type dst, const P& m);
+    inline void receive(uint64_t message_id, id_type src, id_type dst);
+
+    // write events in verbose mode’s format
+    inline void print(std::FILE* f = stdout) const;
+
+    inline void clear() noexcept;
+
+private:
+    std::vector<event> events_;     // grows to `capacity_`, then wraps
+    std::vector<P> messages_;       // by message ID; likewise
+    size_t capacity_;
+    size_t count_ = 0;
+    uint64_t next_id_ = 1;
+    uint64_t first_id_ = 1;         // ID stored in `messages_[0]`
+
+    inline void record(const event& e);
+};
+
 
 // channel<T>
 //    A link from one server to another.
@@ -53,9 +235,25 @@ struct channel {
     void fail() noexcept { failed_ = true; }
     bool failed() const noexcept { return failed_; }
 
+    // Link timing. A message arrives `link_delay() + U(0, jitter())` after
+    // it is sent (capped at 1 minute); the sender can continue after
+    // `send_delay()`. During a parallel run, `set_link_delay` throws
+    // `std::logic_error` if `d` is below the run’s lookahead.
+    cot::clock::duration link_delay() const noexcept { return link_delay_; }
+    void set_link_delay(cot::clock::duration d) {
+        net_.check_link_delay(d);
+        link_delay_ = d;
+    }
+    cot::clock::duration jitter() const noexcept { return jitter_; }
+    void set_jitter(cot::clock::duration d) noexcept { jitter_ = d; }
+    cot::clock::duration send_delay() const noexcept { return send_delay_; }
+    void set_send_delay(cot::clock::duration d) noexcept { send_delay_ = d; }
+
     // send a message on this channel
     cot::task<> send(message_type m);
 
+    static constexpr cot::clock::duration default_link_delay = 20ms;
+
 
 private:
     id_type from_;
@@ -64,10 +262,14 @@ private:
     bool failed_ = false;
     network<T>& net_;
 
-    cot::clock::duration link_delay_ = 20ms; // time for message to arrive
+    cot::clock::duration link_delay_ = default_link_delay; // time for message to arrive
+    cot::clock::duration jitter_ = 1000ms;   // maximum added arrival delay
     cot::clock::duration send_delay_ = 1ms;  // time before sender can continue
 
-    cot::task<> send_after(cot::clock::duration, message_type);
+    using envelope = typename port<T>::envelope;
+
+    inline cot::clock::duration delivery_delay(cot::clock::duration base_delay);
+    cot::task<> send_after(cot::clock::duration, envelope);
 };
 
 
@@ -83,11 +285,6 @@ struct port {
     using message_traits_type = message_traits<T>;
 
     inline port(id_type id, network<T>& net);
-    ~port() {
-        // wake up any `receive` coroutines so that the driver cleanup code
-        // will free their memory
-        receiver_event_.trigger();
-    }
     port(const port<T>&) = delete;
     port(port<T>&&) = delete;
     port<T>& operator=(const port<T>&) = delete;
@@ -99,19 +296,38 @@ struct port {
     bool verbose() const noexcept { return verbose_; }
     void set_verbose(bool verbose) noexcept { verbose_ = verbose; }
 
+    // Processing time after each receive: exponentially distributed with
+    // mean `compute_delay()` (capped at 1 minute). Zero disables it.
+    cot::clock::duration compute_delay() const noexcept { return compute_delay_; }
+    void set_compute_delay(cot::clock::duration d) noexcept { compute_delay_ = d; }
+
     // receive a message on this port
     cot::task<T> receive();
 
 
 private:
     friend struct channel<T>;
+    friend struct network<T>;
 
     id_type id_;
     bool verbose_;
     network<T>& net_;
-
-    std::deque<message_type> messageq_;
-    cot::event receiver_event_;
+    cot::clock::duration compute_delay_ = 100ms;
+
+    // a message in flight, with its sender and trace ID (0 if untraced)
+    struct envelope {
+        message_type message;
+        id_type source;
+        uint64_t trace_id;
+    };
+
+    // Destroying the queue wakes blocked `receive` coroutines, so that the
+    // driver cleanup code will free their memory.
+    cot::channel<envelope> messageq_;
+
+    inline void deliver(envelope e);
+    cot::task<> deliver_at(cot::clock::time_point t, envelope e);
+    inline void unblock();
 };
 
 
@@ -127,39 +343,83 @@ cot::task<> channel<T>::send(message_type m) {
         co_return;
     }
     if (verbose_) {
-        std::print("{}: {} → {} \"{}\"\n", cot::now(), source(), destination(),
-                   message_traits_type::print_transform(m));
+        net_.print_verbose("{}: {} → {} \"{}\"\n", cot::now(), source(),
+                           destination(), message_traits_type::print_transform(m));
+    }
+    envelope e{std::move(m), source(), 0};
+    if (auto trace = net_.trace()) [[unlikely]] {
+        e.trace_id = trace->send(source(), destination(),
+                                 message_traits_type::print_transform(e.message));
     }
 
     // after `link_delay_`, place the message in the receiver’s queue
-    send_after(link_delay_, std::move(m)).detach();
+    if (net_.is_remote(destination())) {
+        // the receiver is in another partition; its thread will schedule
+        // the delivery at the end of the current window (`link_delay_` is
+        // at least the lookahead, so this is in the receiver’s future)
+        net_.post(to_port_, cot::now() + delivery_delay(link_delay_), std::move(e));
+    } else {
+        send_after(link_delay_, std::move(e)).detach();
+    }
 
     // sending a message takes time
     co_await cot::after(send_delay_);
 }
 
 
-// channel<T>::send_after(delay, m)
-//    Delay for `delay` (with added jitter), then enqueue `m` on the
-//    destination port.
+// channel<T>::delivery_delay(base_delay)
+//    Return `base_delay` plus random jitter, capped at 1 minute.
 
 template <typename T>
-cot::task<> channel<T>::send_after(cot::clock::duration base_delay, message_type m) {
+inline cot::clock::duration channel<T>::delivery_delay(cot::clock::duration base_delay) {
     // auto jitter = net_.exponential(100ms);
-    auto jitter = net_.uniform(0ms, 1000ms);
+    auto jitter = net_.uniform(cot::clock::duration(0), jitter_);
     auto total_delay = base_delay + jitter;
     const auto max_delay = cot::clock::duration(1min);
     if (total_delay > max_delay) {
         total_delay = max_delay;
     }
+    return total_delay;
+}
+
 
-    co_await cot::after(total_delay);
+// channel<T>::send_after(delay, e)
+//    Delay for `delay` (with added jitter), then enqueue `e` on the
+//    destination port.
+
+template <typename T>
+cot::task<> channel<T>::send_after(cot::clock::duration base_delay, envelope e) {
+    co_await cot::after(delivery_delay(base_delay));
+    to_port_.deliver(std::move(e));
+}
 
-    // record this message in the destination message queue
-    to_port_.messageq_.emplace_back(std::move(m));
 
-    // wake up a blocked receiver
-    to_port_.receiver_event_.trigger();
+// port<T>::deliver(e), port<T>::deliver_at(t, e)
+//    Enqueue `e` (at time `t`) and wake up a blocked receiver.
+
+template <typename T>
+inline void port<T>::deliver(envelope e) {
+    messageq_.try_push(std::move(e));
+}
+
+template <typename T>
+cot::task<> port<T>::deliver_at(cot::clock::time_point t, envelope e) {
+    co_await cot::at(t);
+    deliver(std::move(e));
+}
+
+
+// port<T>::unblock()
+//    Wake the tasks blocked in `receive`. Only valid while clearing, so that
+//    they unwind. A queue with blocked receivers is empty, so recreating it
+//    loses no messages.
+
+template <typename T>
+inline void port<T>::unblock() {
+    if (messageq_.empty()) {
+        std::destroy_at(&messageq_);
+        std::construct_at(&messageq_);
+    }
 }
 
 
@@ -169,31 +429,29 @@ cot::task<> channel<T>::send_after(cot::clock::duration base_delay, message_type
 template <typename T>
 cot::task<T> port<T>::receive() {
     // sleep until there’s a message
-    while (messageq_.empty()) {
-        // Register an event that senders will trigger on delivery.
-        // Need a new one every time because events are one-shot.
-        co_await (receiver_event_ = cot::event());
-    }
-
-    auto m = std::move(messageq_.front());
-    messageq_.pop_front();
+    auto e = co_await messageq_.pop();
 
     if (verbose_) {
-        std::print("{}: {} ← \"{}\"\n", cot::now(), id(),
-                   message_traits_type::print_transform(m));
+        net_.print_verbose("{}: {} ← \"{}\"\n", cot::now(), id(),
+                           message_traits_type::print_transform(e.message));
+    }
+    if (auto trace = net_.trace()) [[unlikely]] {
+        trace->receive(e.trace_id, e.source, id());
     }
 
     // Model variable computation/processing delay before the receiver
     // continues execution. We draw a random delay and cap it to keep
     // delays finite (satisfying the CT model assumptions).
-    auto compute_delay = net_.exponential(100ms);
-    const auto max_compute_delay = cot::clock::duration(1min);
-    if (compute_delay > max_compute_delay) {
-        compute_delay = max_compute_delay;
+    if (compute_delay_ > cot::clock::duration(0)) {
+        auto compute_delay = net_.exponential(compute_delay_);
+        const auto max_compute_delay = cot::clock::duration(1min);
+        if (compute_delay > max_compute_delay) {
+            compute_delay = max_compute_delay;
+        }
+        co_await cot::after(compute_delay);
     }
-    co_await cot::after(compute_delay);
 
-    co_return m;
+    co_return std::move(e.message);
 }
 
 
@@ -205,14 +463,51 @@ cot::task<T> port<T>::receive() {
 //    server `dst`, and `input(id)` returns the port<T> for server `id`’s input
 //    interface. These functions create the relevant channels and ports as
 //    necessary.
+//
+//    `run_parallel(nworkers, start)` is a parallel replacement for
+//    `cot::loop()`. Server `id` belongs to partition `partition_of(id)`, and
+//    each partition runs on its own thread with its own Cotamer driver;
+//    `start(p)` is called on partition `p`’s thread to start its servers’
+//    coroutines. Partition 0 runs on the calling thread, and the other
+//    threads persist across runs. Synchronization is conservative: every
+//    message takes at least the minimum link delay (the lookahead) to
+//    arrive, so the partitions run independently through windows of that
+//    length and exchange cross-partition messages at window boundaries. The
+//    run ends when no partition has pending work, or after any partition
+//    calls `cot::clear()`, which then clears all partitions.
+//
+//    Each partition draws from its own random generator, seeded from
+//    `randomness()` when the run starts, and cross-partition messages are
+//    scheduled in a fixed order, so a parallel run is deterministic given
+//    the seed and `nworkers`. (It does not reproduce the sequential run for
+//    that seed.) Verbose output is buffered and printed in time order at
+//    the end of each window. During a parallel run, every port must already
+//    exist, only the thread for partition `partition_of(src)` may call
+//    `link(src, dst)`, no link delay may drop below the lookahead
+//    (`set_link_delay` throws), and only partition `partition_of(id)` may
+//    receive on `input(id)`. When the run ends, tasks still blocked in `receive` are
+//    unwound on their own threads, as if cleared. `run_parallel(1, start)`
+//    just calls `start(0)` and `cot::loop()`.
+//
+//    `explore(when, count, finish, jobs)` snapshots a sequential simulation
+//    at virtual time `when` and explores `count` random continuations from
+//    there, each in a forked child process (see below).
 
 template <typename T>
 struct network {
     using channel_type = channel<T>;
     using port_type = port<T>;
-    using random_engine_type = std::mt19937_64;
+    using random_engine_type = random_source;
+    using trace_type = event_trace<std::remove_cvref_t<
+        decltype(message_traits<T>::print_transform(std::declval<const T&>()))>>;
+
+    struct branch {
+        uint64_t seed;              // `randomness()` seed for the continuation
+        int status;                 // `finish()` result, or 128 + signal
+    };
 
     network();
+    ~network();
     network(const network<T>&) = delete;
     network(network<T>&&) = delete;
     network<T>& operator=(const network<T>&) = delete;
@@ -232,8 +527,27 @@ struct network {
     void set_verbose(bool verbose) noexcept { verbose_ = verbose; }
 
 
+    // - event tracing
+    // start tracing into a ring of `capacity` events (0 stops tracing)
+    inline void set_trace(size_t capacity);
+    trace_type* trace() const noexcept { return trace_.get(); }
+
+
+    // - parallel simulation
+    void run_parallel(int nworkers, std::function<void(int)> start);
+    int partitions() const noexcept { return partitions_; }
+    inline int partition_of(id_type id) const noexcept;
+    cot::clock::duration lookahead() const noexcept { return lookahead_; }
+
+
+    // - branch exploration
+    std::vector<branch> explore(cot::clock::time_point when, size_t count,
+                                std::function<int()> finish, int jobs = 1);
+
+
     // - source of randomness
-    random_engine_type& randomness() { return randomness_; }
+    // (in a parallel run, the current partition’s generator)
+    inline random_engine_type& randomness();
 
     // Helper functions for accessing randomness
     // - returning bool
@@ -267,10 +581,56 @@ struct network {
 
 
 private:
-    std::map<std::pair<id_type, id_type>, std::unique_ptr<channel_type>> links_;
+    friend struct channel<T>;
+    friend struct port<T>;
+
+    using link_map = std::map<std::pair<id_type, id_type>, std::unique_ptr<channel_type>>;
+
+    struct remote_message {
+        cot::clock::time_point when;
+        port_type* to;
+        typename port_type::envelope envelope;
+    };
+
+    struct verbose_line {
+        cot::clock::time_point when;
+        std::string text;
+    };
+
+    struct worker_threads {
+        std::vector<std::thread> threads;
+        std::mutex mutex;
+        std::condition_variable cv;
+        std::function<void(int)> job;
+        unsigned generation = 0;
+        int running = 0;
+        bool exiting = false;
+    };
+
+    std::vector<link_map> links_;   // one shard per partition
     std::map<id_type, std::unique_ptr<port_type>> inputs_;
     bool verbose_ = false;
+    std::unique_ptr<trace_type> trace_;
     random_engine_type randomness_;
+
+    int partitions_ = 1;
+    bool running_parallel_ = false;
+    cot::clock::duration lookahead_ = channel_type::default_link_delay;
+    std::vector<random_engine_type> partition_randomness_;
+    std::vector<std::vector<remote_message>> outboxes_;  // [src * partitions_ + dst]
+    std::vector<std::vector<verbose_line>> verbose_lines_;  // per partition
+    std::unique_ptr<worker_threads> workers_;
+
+    inline bool is_remote(id_type dst) const noexcept;
+    inline void check_link_delay(cot::clock::duration d) const;
+    inline void post(port_type& to, cot::clock::time_point when,
+                     typename port_type::envelope e);
+    template <typename... Args>
+    inline void print_verbose(std::format_string<Args...> fmt, Args&&... args);
+    void flush_verbose();
+    void set_partitions(int n);
+    void run_workers(int n, std::function<void(int)> job);
+    void stop_workers();
 };
 
 
@@ -292,9 +652,10 @@ inline port<T>::port(id_type id, network<T>& net)
 
 template <typename T>
 inline channel<T>& network<T>::link(id_type from, id_type to) {
-    auto& link = links_[{from, to}];
+    auto& link = links_[partitions_ > 1 ? partition_of(from) : 0][{from, to}];
     if (!link) {
         link.reset(new channel_type(from, to, *this));
+        check_link_delay(link->link_delay());
     }
     return *link;
 }
@@ -304,11 +665,13 @@ inline channel<T>& network<T>::link(id_type from, id_type to) {
 
 template <typename T>
 inline port<T>& network<T>::input(id_type id) {
-    auto& input = inputs_[id];
-    if (!input) {
-        input.reset(new port_type(id, *this));
+    auto it = inputs_.find(id);
+    if (it == inputs_.end()) {
+        // ports cannot be created while other threads look them up
+        assert(!running_parallel_);
+        it = inputs_.emplace(id, new port_type(id, *this)).first;
     }
-    return *input;
+    return *it->second;
 }
 
 
@@ -317,7 +680,19 @@ inline port<T>& network<T>::input(id_type id) {
 
 template <typename T>
 network<T>::network()
-    : randomness_(randomly_seeded<random_engine_type>()) {
+    : links_(1), randomness_(randomly_seeded<random_source::engine_type>()) {
+}
+
+template <typename T>
+network<T>::~network() {
+    stop_workers();
+}
+
+
+template <typename T>
+inline auto network<T>::randomness() -> random_engine_type& {
+    int p = detail::current_partition;
+    return p >= 0 ? partition_randomness_[p] : randomness_;
 }
 
 
@@ -325,13 +700,13 @@ network<T>::network()
 
 template <typename T>
 inline bool network<T>::coin_flip() {
-    return std::uniform_int_distribution<int>(0, 1)(randomness_);
+    return std::uniform_int_distribution<int>(0, 1)(randomness());
 }
 
 template <typename T>
 inline bool network<T>::coin_flip(double probability_of_true) {
     constexpr uint64_t one = uint64_t(1) << 53;
-    auto val = std::uniform_int_distribution<uint64_t>(0, one - 1)(randomness_);
+    auto val = std::uniform_int_distribution<uint64_t>(0, one - 1)(randomness());
     return val < static_cast<uint64_t>(probability_of_true * one);
 }
 
@@ -339,20 +714,20 @@ template <typename T>
 template <typename U>
 inline U network<T>::uniform(std::initializer_list<U> list) {
     assert(list.size() > 0);
-    auto idx = std::uniform_int_distribution<size_t>(0, list.size() - 1)(randomness_);
+    auto idx = std::uniform_int_distribution<size_t>(0, list.size() - 1)(randomness());
     return list.begin()[idx];
 }
 
 template <typename T>
 template <std::integral I>
 inline I network<T>::uniform(I min, I max) {
-    return std::uniform_int_distribution<I>(min, max)(randomness_);
+    return std::uniform_int_distribution<I>(min, max)(randomness());
 }
 
 template <typename T>
 template <std::floating_point FP>
 inline FP network<T>::uniform(FP min, FP max) {
-    return std::uniform_real_distribution<FP>(min, max)(randomness_);
+    return std::uniform_real_distribution<FP>(min, max)(randomness());
 }
 
 template <typename T>
@@ -361,26 +736,26 @@ inline cot::clock::duration network<T>::uniform(
 ) {
     using rep = cot::clock::duration::rep;
     std::uniform_int_distribution<rep> dist(min.count(), max.count());
-    return cot::clock::duration(dist(randomness_));
+    return cot::clock::duration(dist(randomness()));
 }
 
 template <typename T>
 template <std::floating_point FP>
 inline FP network<T>::exponential(FP mean) {
-    return std::exponential_distribution<FP>(1.0 / mean)(randomness_);
+    return std::exponential_distribution<FP>(1.0 / mean)(randomness());
 }
 
 template <typename T>
 inline cot::clock::duration network<T>::exponential(cot::clock::duration mean) {
     using rep = cot::clock::duration::rep;
     std::exponential_distribution<double> dist(1.0 / mean.count());
-    return cot::clock::duration(static_cast<rep>(dist(randomness_)));
+    return cot::clock::duration(static_cast<rep>(dist(randomness())));
 }
 
 template <typename T>
 template <std::floating_point FP>
 inline FP network<T>::normal(FP mean, FP stddev) {
-    return std::normal_distribution<FP>(mean, stddev)(randomness_);
+    return std::normal_distribution<FP>(mean, stddev)(randomness());
 }
 
 template <typename T>
@@ -389,7 +764,7 @@ inline cot::clock::duration network<T>::normal(
 ) {
     using rep = cot::clock::duration::rep;
     std::normal_distribution<double> dist(mean.count(), stddev.count());
-    return cot::clock::duration(static_cast<rep>(std::max(dist(randomness_), 0.0)));
+    return cot::clock::duration(static_cast<rep>(std::max(dist(randomness()), 0.0)));
 }
 
 
@@ -399,11 +774,502 @@ inline cot::clock::duration network<T>::normal(
 
 template <typename T>
 void network<T>::clear() {
-    links_.clear();
+    for (auto& shard : links_) {
+        shard.clear();
+    }
     inputs_.clear();
 }
 
 
+// network<T>::set_trace(capacity)
+//    Start tracing into a new ring of `capacity` events, or stop if 0.
+
+template <typename T>
+inline void network<T>::set_trace(size_t capacity) {
+    if (capacity == 0) {
+        trace_.reset();
+    } else {
+        trace_.reset(new trace_type(capacity));
+    }
+}
+
+
+// Parallel simulation
+
+template <typename T>
+inline int network<T>::partition_of(id_type id) const noexcept {
+    int p = id % partitions_;
+    return p < 0 ? p + partitions_ : p;
+}
+
+template <typename T>
+inline bool network<T>::is_remote(id_type dst) const noexcept {
+    return partitions_ > 1 && partition_of(dst) != detail::current_partition;
+}
+
+// network<T>::check_link_delay(d)
+//    Throw if a link delay of `d` would break the running parallel
+//    simulation: a cross-partition message could land in its receiver’s
+//    past.
+
+template <typename T>
+inline void network<T>::check_link_delay(cot::clock::duration d) const {
+    if (running_parallel_ && d < lookahead_) {
+        throw std::logic_error("netsim: link delay below the parallel run’s lookahead");
+    }
+}
+
+template <typename T>
+inline void network<T>::post(port_type& to, cot::clock::time_point when,
+                             typename port_type::envelope e) {
+    int src = detail::current_partition;
+    assert(src >= 0);
+    outboxes_[src * partitions_ + partition_of(to.id())].push_back(
+        remote_message{when, &to, std::move(e)}
+    );
+}
+
+// network<T>::print_verbose(fmt, args...), network<T>::flush_verbose()
+//    Print a verbose trace line. During a parallel run, lines are buffered
+//    per partition and printed at the end of each window in (time,
+//    partition) order, so the output is deterministic.
+
+template <typename T>
+template <typename... Args>
+inline void network<T>::print_verbose(std::format_string<Args...> fmt, Args&&... args) {
+    int p = detail::current_partition;
+    if (p < 0) {
+        std::print(fmt, std::forward<Args>(args)...);
+    } else {
+        verbose_lines_[p].push_back(
+            verbose_line{cot::now(), std::format(fmt, std::forward<Args>(args)...)}
+        );
+    }
+}
+
+template <typename T>
+void network<T>::flush_verbose() {
+    std::vector<verbose_line> lines;
+    for (auto& pl : verbose_lines_) {
+        std::move(pl.begin(), pl.end(), std::back_inserter(lines));
+        pl.clear();
+    }
+    // each partition’s lines are in time order, so a stable sort by time
+    // puts ties in partition order
+    std::stable_sort(lines.begin(), lines.end(), [] (auto& a, auto& b) {
+        return a.when < b.when;
+    });
+    for (auto& l : lines) {
+        std::fputs(l.text.c_str(), stdout);
+    }
+}
+
+
+// network<T>::set_partitions(n)
+//    Re-shard the links for `n` partitions.
+
+template <typename T>
+void network<T>::set_partitions(int n) {
+    std::vector<link_map> old;
+    old.swap(links_);
+    partitions_ = n;
+    links_.resize(n);
+    for (auto& shard : old) {
+        for (auto& [key, ch] : shard) {
+            links_[n > 1 ? partition_of(key.first) : 0].emplace(key, std::move(ch));
+        }
+    }
+    outboxes_.clear();
+    outboxes_.resize(n > 1 ? n * n : 0);
+}
+
+// network<T>::run_parallel(nworkers, start)
+//    Run partitions 0 through `nworkers - 1` to completion.
+
+template <typename T>
+void network<T>::run_parallel(int nworkers, std::function<void(int)> start) {
+    assert(nworkers >= 1);
+    if (nworkers == 1) {
+        start(0);
+        cot::loop();
+        return;
+    }
+    if (trace_) {
+        throw std::logic_error("netsim: tracing is not supported in parallel runs");
+    }
+
+    int n = nworkers;
+    set_partitions(n);
+    lookahead_ = channel_type::default_link_delay;
+    for (auto& shard : links_) {
+        for (auto& [key, ch] : shard) {
+            lookahead_ = std::min(lookahead_, ch->link_delay());
+        }
+    }
+    if (lookahead_ <= cot::clock::duration(0)) {
+        throw std::logic_error("netsim: parallel runs need positive link delays");
+    }
+    partition_randomness_.resize(n);
+    for (auto& r : partition_randomness_) {
+        r.seed(randomness_());
+    }
+
+    // Window state. Each partition publishes its next event time and whether
+    // it called `cot::clear()`; the barrier’s completion step computes the
+    // next window.
+    std::vector<cot::clock::time_point> next(n);
+    std::vector<char> cleared(n, 0);
+    cot::clock::time_point limit;
+    bool stop = false, done = false;
+    verbose_lines_.resize(n);
+    std::latch started(n);
+    std::barrier sync(n, [&] () noexcept {
+        flush_verbose();
+        auto t = *std::min_element(next.begin(), next.end());
+        stop = std::find(cleared.begin(), cleared.end(), 1) != cleared.end();
+        done = t == cot::clock::time_point::max();
+        limit = done ? t : t + lookahead_;
+    });
+
+    running_parallel_ = true;
+    run_workers(n, [&] (int p) {
+        detail::current_partition = p;
+        if (p != 0) {
+            cot::reset();
+        }
+        start(p);
+        started.arrive_and_wait();
+
+        bool my_cleared = false;
+        while (true) {
+            // schedule messages sent to this partition in the last window,
+            // in source-partition order
+            for (int src = 0; src != n; ++src) {
+                auto& box = outboxes_[src * n + p];
+                for (auto& rm : box) {
+                    rm.to->deliver_at(rm.when, std::move(rm.envelope)).detach();
+                }
+                box.clear();
+            }
+            next[p] = cot::driver::current().next_time();
+            cleared[p] = my_cleared;
+            sync.arrive_and_wait();
+            if (stop || done) {
+                break;
+            }
+            my_cleared = cot::driver::current().loop_until(limit);
+            sync.arrive_and_wait();
+        }
+        // Unwind tasks still blocked in `receive` on this partition’s
+        // ports here, on their own thread. Left blocked, they would be
+        // woken on the wrong driver by a later run or `clear()`.
+        cot::clear();
+        for (auto& [id, port] : inputs_) {
+            if (partition_of(id) == p) {
+                port->unblock();
+            }
+        }
+        cot::loop();
+        detail::current_partition = -1;
+    });
+    running_parallel_ = false;
+    flush_verbose();
+    verbose_lines_.clear();
+    set_partitions(1);
+}
+
+// network<T>::run_workers(n, job)
+//    Run `job(p)` for p in [0, n): `job(0)` on this thread, the rest on
+//    worker threads. Returns when all are done.
+
+template <typename T>
+void network<T>::run_workers(int n, std::function<void(int)> job) {
+    if (workers_ && int(workers_->threads.size()) != n - 1) {
+        stop_workers();
+    }
+    if (!workers_) {
+        workers_.reset(new worker_threads);
+        for (int p = 1; p != n; ++p) {
+            workers_->threads.emplace_back([w = workers_.get(), p] () {
+                unsigned seen = 0;
+                std::unique_lock lock(w->mutex);
+                while (true) {
+                    w->cv.wait(lock, [&] () {
+                        return w->exiting || w->generation != seen;
+                    });
+                    if (w->exiting) {
+                        return;
+                    }
+                    seen = w->generation;
+                    lock.unlock();
+                    w->job(p);
+                    lock.lock();
+                    if (--w->running == 0) {
+                        w->cv.notify_all();
+                    }
+                }
+            });
+        }
+    }
+
+    auto& w = *workers_;
+    {
+        std::lock_guard lock(w.mutex);
+        w.job = std::move(job);
+        w.running = n - 1;
+        ++w.generation;
+    }
+    w.cv.notify_all();
+    w.job(0);
+    std::unique_lock lock(w.mutex);
+    w.cv.wait(lock, [&] () { return w.running == 0; });
+}
+
+template <typename T>
+void network<T>::stop_workers() {
+    if (workers_) {
+        {
+            std::lock_guard lock(workers_->mutex);
+            workers_->exiting = true;
+        }
+        workers_->cv.notify_all();
+        for (auto& t : workers_->threads) {
+            t.join();
+        }
+        workers_.reset();
+    }
+}
+
+
+// network<T>::explore(when, count, finish, jobs)
+//    Run the simulation up to virtual time `when`, then fork `count` child
+//    processes from that state, at most `jobs` at a time. Child i reseeds
+//    `randomness()` with branch i’s seed, runs to completion with
+//    `cot::loop()`, and exits with status `finish()` (0 means success). So
+//    the shared prefix is simulated once, and a child costs only the pages
+//    its continuation touches. (A fork costs about a millisecond, so this
+//    pays off when the prefix takes longer than that to simulate.) Returns
+//    each branch’s seed and exit status.
+//
+//    Branch seeds are drawn from a copy of `randomness()`, so exploration is
+//    deterministic given the run’s seed, and the parent’s simulation is left
+//    untouched at `when` (typically, the caller then clears it). To replay a
+//    branch in-process, run to `when` with `driver::loop_until`, seed
+//    `randomness()` with the branch seed, and call `cot::loop()`. Returns no
+//    branches if the simulation ends before `when`. Sequential simulations
+//    only; requires `fork()`.
+
+template <typename T>
+auto network<T>::explore(cot::clock::time_point when, size_t count,
+                         std::function<int()> finish, int jobs)
+    -> std::vector<branch> {
+    assert(partitions_ == 1 && jobs >= 1);
+    std::vector<branch> branches;
+    auto& driver = cot::driver::current();
+    if (driver.loop_until(when)
+        || driver.next_time() == cot::clock::time_point::max()) {
+        return branches;
+    }
+#ifdef _WIN32
+    (void) count, (void) finish, (void) jobs;
+    throw std::runtime_error("netsim::network::explore requires fork()");
+#else
+    auto seeds = randomness_.engine();  // a copy, not logged
+    branches.resize(count);
+    for (auto& b : branches) {
+        b.seed = seeds();
+        b.status = -1;
+    }
+
+    std::map<pid_t, size_t> running;    // child → branch index
+    size_t next = 0;
+    std::fflush(nullptr);               // children must not repeat our output
+    while (next != count || !running.empty()) {
+        if (next != count && int(running.size()) < jobs) {
+            pid_t pid = fork();
+            if (pid == 0) {
+                int status = 255;
+                try {
+                    randomness_.seed(branches[next].seed);
+                    cot::loop();
+                    status = finish();
+                } catch (...) {
+                }
+                std::fflush(nullptr);
+                _exit(status);
+            } else if (pid < 0) {
+                throw std::system_error(errno, std::generic_category(), "fork");
+            }
+            running.emplace(pid, next);
+            ++next;
+            continue;
+        }
+        int wstatus;
+        pid_t pid = waitpid(-1, &wstatus, 0);
+        if (pid < 0 && errno != EINTR) {
+            throw std::system_error(errno, std::generic_category(), "waitpid");
+        } else if (auto it = running.find(pid); it != running.end()) {
+            branches[it->second].status = WIFEXITED(wstatus)
+                ? WEXITSTATUS(wstatus) : 128 + WTERMSIG(wstatus);
+            running.erase(it);
+        }
+    }
+    return branches;
+#endif
+}
+
+
+// random_log functions
+
+template <typename Engine>
+inline uint64_t random_log::draw(Engine& engine) {
+    auto now = cot::now();
+    size_t i = position_++;
+    if (i >= entries_.size()) {
+        uint64_t v = engine();
+        entries_.push_back(entry{now, v});
+        return v;
+    }
+    if (!diverged_ && entries_[i].when != now) {
+        diverged_ = i;
+    }
+    return entries_[i].value;
+}
+
+inline void random_log::save(const std::string& path) const {
+    std::string buf = "NSRL";
+    int64_t last = 0;
+    for (auto& e : entries_) {
+        int64_t t = e.when.time_since_epoch().count();
+        uint64_t zz = (uint64_t(t - last) << 1) ^ uint64_t((t - last) >> 63);
+        last = t;
+        for (; zz >= 0x80; zz >>= 7) {
+            buf.push_back(char(zz | 0x80));
+        }
+        buf.push_back(char(zz));
+        for (int b = 0; b != 8; ++b) {
+            buf.push_back(char(e.value >> (8 * b)));
+        }
+    }
+    std::ofstream f(path, std::ios::binary);
+    if (!f.write(buf.data(), buf.size())) {
+        throw std::runtime_error(std::format("{}: cannot write random log", path));
+    }
+}
+
+inline random_log random_log::load(const std::string& path) {
+    std::ifstream f(path, std::ios::binary);
+    if (!f) {
+        throw std::runtime_error(std::format("{}: cannot read random log", path));
+    }
+    std::string buf((std::istreambuf_iterator<char>(f)), std::istreambuf_iterator<char>());
+    if (!buf.starts_with("NSRL")) {
+        throw std::runtime_error(std::format("{}: not a random log", path));
+    }
+    random_log log;
+    int64_t t = 0;
+    size_t pos = 4;
+    while (pos != buf.size()) {
+        uint64_t zz = 0;
+        for (int shift = 0; true; shift += 7) {
+            if (pos == buf.size() || shift > 63) {
+                throw std::runtime_error(std::format("{}: truncated random log", path));
+            }
+            uint8_t byte = buf[pos++];
+            zz |= uint64_t(byte & 0x7F) << shift;
+            if (!(byte & 0x80)) {
+                break;
+            }
+        }
+        t += int64_t(zz >> 1) ^ -int64_t(zz & 1);
+        if (buf.size() - pos < 8) {
+            throw std::runtime_error(std::format("{}: truncated random log", path));
+        }
+        uint64_t v = 0;
+        for (int b = 0; b != 8; ++b) {
+            v |= uint64_t(uint8_t(buf[pos++])) << (8 * b);
+        }
+        log.entries_.push_back(entry{cot::clock::time_point(cot::clock::duration(t)), v});
+    }
+    return log;
+}
+
+
+// event_trace<P> functions
+
+template <typename P>
+inline event_trace<P>::event_trace(size_t capacity)
+    : capacity_(capacity) {
+    assert(capacity > 0);
+}
+
+template <typename P>
+inline auto event_trace<P>::at(size_t i) const noexcept -> const event& {
+    return events_[(count_ - size() + i) % capacity_];
+}
+
+template <typename P>
+inline const P* event_trace<P>::message(size_t i) const noexcept {
+    uint64_t id = at(i).message_id;
+    if (id < first_id_ || next_id_ - id > messages_.size()) {
+        return nullptr;
+    }
+    return &messages_[(id - first_id_) % capacity_];
+}
+
+template <typename P>
+inline void event_trace<P>::record(const event& e) {
+    if (events_.size() < capacity_) {
+        events_.push_back(e);
+    } else {
+        events_[count_ % capacity_] = e;
+    }
+    ++count_;
+}
+
+template <typename P>
+inline void event_trace<P>::clear() noexcept {
+    events_.clear();
+    messages_.clear();
+    count_ = 0;
+    first_id_ = next_id_;
+}
+
+template <typename P>
+inline uint64_t event_trace<P>::send(id_type src, id_type dst, const P& m) {
+    uint64_t id = next_id_++;
+    record(event{cot::now(), id, src, dst, trace_kind::send});
+    if (messages_.size() < capacity_) {
+        messages_.push_back(m);
+    } else {
+        messages_[(id - first_id_) % capacity_] = m;   // reuses the slot’s storage
+    }
+    return id;
+}
+
+template <typename P>
+inline void event_trace<P>::receive(uint64_t message_id, id_type src, id_type dst) {
+    record(event{cot::now(), message_id, src, dst, trace_kind::receive});
+}
+
+template <typename P>
+inline void event_trace<P>::print(std::FILE* f) const {
+    for (size_t i = 0; i != size(); ++i) {
+        auto& e = at(i);
+        const P* m = message(i);
+        if (e.kind == trace_kind::send) {
+            std::print(f, "{}: {} → {} \"{}\"\n", e.when, e.source,
+                       e.destination, *m);
+        } else if (m) {
+            std::print(f, "{}: {} ← \"{}\"\n", e.when, e.destination, *m);
+        } else {
+            std::print(f, "{}: {} ← message {}\n", e.when, e.destination,
+                       e.message_id);
+        }
+    }
+}
+
+
 // message_traits<T>
 //    This template lets us change the behavior of network functions based on
 //    message type. We provide specializations that allow you to print
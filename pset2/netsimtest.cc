@@ -0,0 +1,175 @@
+#include "cotamer.hh"
+#include "netsim.hh"
+#include <cstdlib>
+#include <print>
+
+// netsimtest.cc
+//    Checks for netsim behavior that the example programs don’t exercise.
+
+namespace cot = cotamer;
+using namespace std::chrono_literals;
+using namespace netsim;
+
+static void check(bool ok, const char* what) {
+    if (!ok) {
+        std::print(std::cerr, "netsimtest: FAILED: {}\n", what);
+        std::exit(1);
+    }
+}
+
+
+// A receive loop with no timers, which only ends by unwinding.
+
+static cot::task<> bare_receiver(port<int>& in, int& received) {
+    while (true) {
+        co_await in.receive();
+        ++received;
+    }
+}
+
+static cot::task<> clear_after(cot::clock::duration d) {
+    co_await cot::after(d);
+    cot::clear();
+}
+
+static cot::task<> send_one(channel<int>& out) {
+    co_await out.send(1);
+}
+
+
+// A parallel run must unwind tasks blocked in `receive` on their own
+// partitions’ threads, whether it ends by `cot::clear()` or by running out
+// of work.
+
+static void test_parallel_blocked_receivers() {
+    network<int> net;
+    net.input(0);
+    net.input(1);
+    auto frames0 = cot::driver_stats().live_frames;
+
+    // ended by `clear()` on partition 0
+    int received = 0;
+    net.run_parallel(2, [&] (int p) {
+        if (p == 1) {
+            bare_receiver(net.input(1), received).detach();
+        } else {
+            clear_after(1s).detach();
+        }
+    });
+    net.clear();
+    check(cot::driver::current().ready_size() == 0,
+          "clear() woke another partition’s receiver on this thread");
+    cot::reset();
+    check(cot::driver_stats().live_frames == frames0,
+          "another partition’s frame was freed on this thread");
+
+    // ended by running out of work; the network is then reused
+    int first = 0, second = 0;
+    net.input(0);
+    net.input(1);
+    net.run_parallel(2, [&] (int p) {
+        if (p == 1) {
+            bare_receiver(net.input(1), first).detach();
+        } else {
+            send_one(net.link(0, 1)).detach();
+        }
+    });
+    net.run_parallel(2, [&] (int p) {
+        if (p == 1) {
+            bare_receiver(net.input(1), second).detach();
+        } else {
+            send_one(net.link(0, 1)).detach();
+        }
+    });
+    check(first == 1 && second == 1,
+          "a receiver from an earlier run consumed a later run’s message");
+    net.clear();
+    cot::reset();
+    check(cot::driver_stats().live_frames == frames0,
+          "frames leaked after parallel runs");
+}
+
+
+// During a parallel run, a link may not become faster than the lookahead,
+// or a cross-partition message could arrive in its receiver’s past.
+
+static void test_parallel_lookahead() {
+    network<int> net;
+    net.input(0);
+    net.input(1);
+    net.link(0, 1).set_link_delay(10ms);
+    bool threw = false;
+    net.run_parallel(2, [&] (int p) {
+        if (p == 0) {
+            net.link(0, 1).set_link_delay(10ms);
+            try {
+                net.link(0, 1).set_link_delay(5ms);
+            } catch (const std::logic_error&) {
+                threw = true;
+            }
+        }
+    });
+    check(threw, "set_link_delay accepted a delay below the lookahead");
+    check(net.link(0, 1).link_delay() == 10ms,
+          "a rejected link delay was applied");
+    net.link(0, 1).set_link_delay(5ms);
+    check(net.link(0, 1).link_delay() == 5ms,
+          "set_link_delay refused a delay outside a parallel run");
+}
+
+
+// A trace stores each message once, at send. A receive that outlives its
+// message’s copy still names the message by ID.
+
+static cot::task<> send_many(channel<int>& out, int n) {
+    for (int i = 0; i != n; ++i) {
+        co_await out.send(i);
+    }
+}
+
+static cot::task<> receive_many(port<int>& in, int n) {
+    for (int i = 0; i != n; ++i) {
+        co_await in.receive();
+    }
+}
+
+static void test_trace_ring() {
+    network<int> net;
+    net.set_trace(4);
+    auto& slow = net.link(0, 1);
+    slow.set_jitter(0ms);
+    slow.set_link_delay(10s);
+    auto& fast = net.link(0, 2);
+    fast.set_jitter(0ms);
+    fast.set_link_delay(1s);
+    // message 1 is sent first and received last
+    send_many(slow, 1).detach();
+    send_many(fast, 5).detach();
+    receive_many(net.input(1), 1).detach();
+    receive_many(net.input(2), 5).detach();
+    cot::loop();
+
+    auto* trace = net.trace();
+    check(trace->size() == 4 && trace->dropped() == 8,
+          "trace ring kept the wrong number of events");
+    for (size_t i = 0; i != trace->size(); ++i) {
+        auto& e = trace->at(i);
+        check(e.kind == trace_kind::receive, "trace kept an old send");
+        auto* m = trace->message(i);
+        if (e.message_id == 1) {
+            check(i == 3 && !m, "trace kept an overwritten message");
+        } else {
+            check(m && *m == int(e.message_id) - 2,
+                  "trace returned the wrong message for a receive");
+        }
+    }
+    net.clear();
+    cot::reset();
+}
+
+int main() {
+    test_parallel_blocked_receivers();
+    test_parallel_lookahead();
+    test_trace_ring();
+    std::print("netsimtest: all tests passed\n");
+}
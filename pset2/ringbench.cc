@@ -0,0 +1,106 @@
+#include "cotamer.hh"
+#include "utils.hh"
+#include <deque>
+#include <print>
+
+// ringbench.cc
+//    Compare `std::deque` with `ring_buffer` on the driver’s queue pattern
+//    (pop from the front, push at the back, steady depth), for both queue
+//    element types the driver uses; elements are moved, as in the driver.
+//    Then measure driver resumptions per second on a workload that cycles
+//    through `asap_` and `ready_`.
+
+namespace cot = cotamer;
+using steady_clock = std::chrono::steady_clock;
+
+volatile uintptr_t sink;
+
+inline uintptr_t element_value(std::coroutine_handle<> h) {
+    return reinterpret_cast<uintptr_t>(h.address());
+}
+
+inline uintptr_t element_value(const cot::event& e) {
+    return reinterpret_cast<uintptr_t>(e.handle().get());
+}
+
+template <typename Q, typename T>
+double queue_ns_per_op(size_t depth, uint64_t n, const std::vector<T>& items) {
+    Q q;
+    for (size_t i = 0; i != depth; ++i) {
+        q.push_back(items[i % items.size()]);
+    }
+    uintptr_t check = 0;
+    auto t0 = steady_clock::now();
+    for (uint64_t i = 0; i != n; ++i) {
+        T x = std::move(q.front());
+        q.pop_front();
+        check += element_value(x);
+        q.push_back(std::move(x));
+    }
+    std::chrono::duration<double, std::nano> d = steady_clock::now() - t0;
+    sink = check;
+    return d.count() / n;
+}
+
+template <typename T>
+void compare(const char* name, uint64_t n, const std::vector<T>& items) {
+    for (size_t depth : {1, 16, 1024, 65536}) {
+        double dq = queue_ns_per_op<std::deque<T>>(depth, n, items);
+        double rb = queue_ns_per_op<ring_buffer<T>>(depth, n, items);
+        std::print("{:<22} {:>8} {:>12.2f} {:>12.2f}\n", name, depth, dq, rb);
+    }
+}
+
+
+// - `ntasks` tasks each wait on `cot::asap()` `rounds` times
+cot::task<> asap_cycler(uint64_t rounds) {
+    for (uint64_t i = 0; i != rounds; ++i) {
+        co_await cot::asap();
+    }
+}
+
+static struct option options[] = {
+    { "count", required_argument, nullptr, 'n' },
+    { "tasks", required_argument, nullptr, 't' },
+    { nullptr, 0, nullptr, 0 }
+};
+
+int main(int argc, char* argv[]) {
+    uint64_t n = 20000000;
+    uint64_t ntasks = 1000;
+
+    auto shortopts = short_options_for(options);
+    int ch;
+    while ((ch = getopt_long(argc, argv, shortopts.c_str(), options, nullptr)) != -1) {
+        if (ch == 'n') {
+            n = from_str_chars<uint64_t>(optarg);
+        } else if (ch == 't') {
+            ntasks = from_str_chars<uint64_t>(optarg);
+        } else {
+            std::print(std::cerr, "Unknown option\n");
+            return 1;
+        }
+    }
+
+    // Queue elements: fake coroutine handles, and distinct events
+    std::vector<std::coroutine_handle<>> handles;
+    std::vector<cot::event> events;
+    for (uintptr_t i = 1; i <= 256; ++i) {
+        handles.push_back(std::coroutine_handle<>::from_address(reinterpret_cast<void*>(i * 64)));
+        events.emplace_back();
+    }
+
+    std::print("{:<22} {:>8} {:>12} {:>12}\n", "queue", "depth", "deque ns/op", "ring ns/op");
+    compare("coroutine_handle<>", n, handles);
+    compare("event", n, events);
+
+    uint64_t rounds = std::max<uint64_t>(n / std::max<uint64_t>(ntasks, 1), 1);
+    for (uint64_t i = 0; i != ntasks; ++i) {
+        asap_cycler(rounds).detach();
+    }
+    auto t0 = steady_clock::now();
+    cot::loop();
+    std::chrono::duration<double> d = steady_clock::now() - t0;
+    std::print("\ndriver: {} tasks x {} asap waits, {:.0f} resumptions/sec\n",
+               ntasks, rounds, ntasks * rounds / d.count());
+}
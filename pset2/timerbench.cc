@@ -0,0 +1,98 @@
+#include "detail/timer_wheel.hh"
+#include "utils.hh"
+#include <cassert>
+#include <print>
+#include <random>
+
+// timerbench.cc
+//    Compare `timer_heap` with `timer_wheel` on the classic “hold” model:
+//    keep N timers pending; repeatedly pop the earliest timer and schedule
+//    a new one a random delay after it. Delays are uniform up to 2 seconds
+//    (like netsim link delays plus jitter). Reports ns per pop+insert, plus
+//    the time to insert the initial N timers.
+
+using steady_clock = std::chrono::steady_clock;
+using time_point = std::chrono::system_clock::time_point;
+
+struct fake_timer {
+    uint64_t id;
+    bool empty() const {
+        return false;
+    }
+};
+
+struct result {
+    double fill_ns;
+    double hold_ns;
+    uint64_t check;
+};
+
+template <template <typename> class Q>
+result hold(uint64_t n, uint64_t ops, unsigned long seed) {
+    std::mt19937_64 rng(seed);
+    std::uniform_int_distribution<int64_t> delay(1, 2'000'000'000);
+    auto now = std::chrono::system_clock::from_time_t(1634070069);
+    result r{};
+
+    Q<fake_timer> q;
+    auto t0 = steady_clock::now();
+    for (uint64_t i = 0; i != n; ++i) {
+        q.emplace(now + std::chrono::nanoseconds(delay(rng)), fake_timer{i});
+    }
+    std::chrono::duration<double, std::nano> d = steady_clock::now() - t0;
+    r.fill_ns = d.count() / n;
+
+    t0 = steady_clock::now();
+    for (uint64_t i = 0; i != ops; ++i) {
+        now = q.top_time();
+        r.check += q.top().id;
+        q.pop();
+        q.emplace(now + std::chrono::nanoseconds(delay(rng)), fake_timer{n + i});
+    }
+    d = steady_clock::now() - t0;
+    r.hold_ns = d.count() / ops;
+    assert(q.size() == n);
+    return r;
+}
+
+
+static struct option options[] = {
+    { "max", required_argument, nullptr, 'N' },
+    { "count", required_argument, nullptr, 'n' },
+    { "seed", required_argument, nullptr, 'S' },
+    { nullptr, 0, nullptr, 0 }
+};
+
+int main(int argc, char* argv[]) {
+    uint64_t max_n = 10'000'000;
+    uint64_t ops = 2'000'000;
+    unsigned long seed = 8173;
+
+    auto shortopts = short_options_for(options);
+    int ch;
+    while ((ch = getopt_long(argc, argv, shortopts.c_str(), options, nullptr)) != -1) {
+        if (ch == 'N') {
+            max_n = from_str_chars<uint64_t>(optarg);
+        } else if (ch == 'n') {
+            ops = from_str_chars<uint64_t>(optarg);
+        } else if (ch == 'S') {
+            seed = from_str_chars<unsigned long>(optarg);
+        } else {
+            std::print(std::cerr, "Unknown option\n");
+            return 1;
+        }
+    }
+
+    std::print("{:>10} {:>12} {:>12} {:>12} {:>12}\n", "timers",
+               "heap fill", "wheel fill", "heap hold", "wheel hold");
+    for (uint64_t n = 1000; n <= max_n; n *= 10) {
+        auto h = hold<timer_heap>(n, ops, seed);
+        auto w = hold<timer_wheel>(n, ops, seed);
+        if (h.check != w.check) {
+            std::print(std::cerr, "*** timer order differs at {} timers\n", n);
+            return 1;
+        }
+        std::print("{:>10} {:>9.1f} ns {:>9.1f} ns {:>9.1f} ns {:>9.1f} ns\n",
+                   n, h.fill_ns, w.fill_ns, h.hold_ns, w.hold_ns);
+    }
+}